@@ -0,0 +1,220 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "stdbool.h"
+#include "math.h"
+#include "signal.h"
+
+#include "prng.c"
+#include "cube.c"
+#include "moves.c"
+#include "sequence.c"
+#include "locdir.c"
+#include "tablebase.c"
+#include "goalsphere.c"
+#include "ida_star.c"
+#include "solution_cache.c"
+#include "global_solver.c"
+#include "two_phase.c"
+
+/*
+Solve many scrambles with the tables loaded only once.
+
+Reads one scramble per line from the given file or stdin and prints one solution per line in the same order.
+Lines are solved a chunk at a time with one scramble per thread when compiled with -fopenmp.
+Throughput and latency statistics are reported to stderr at the end.
+
+Usage: ./batch-solve.out [--two-phase | --anytime] [--target=<moves>] [--budget=<seconds>] [--nodes=<count>] [file]
+With --two-phase the solutions are not optimal but come from two_phase.c which only needs its small tables.
+Each scramble is improved until it has at most the target number of moves or its time budget runs out.
+With --anytime the optimal search starts from a two-phase solution and gives up when the budget of the scramble runs out.
+The best solution is then printed with the proven lower bound.
+
+An interrupt cancels the solves in progress and stops after the current chunk with the statistics so far.
+*/
+
+// Part of the budget of an anytime solve spent on the two-phase solution that the optimal search tries to beat
+#define BATCH_SEED_BUDGET_FRACTION (0.1)
+
+#define BATCH_CHUNK_SIZE (256)
+#define BATCH_MAX_LINE_LENGTH (1024)
+
+double monotonic_seconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+CancelToken BATCH_CANCEL_TOKEN;
+
+void cancel_batch(int signal) {
+  cancel_searches(&BATCH_CANCEL_TOKEN);
+}
+
+int cmp_double(const void *a, const void *b) {
+  double x = *(double*)a;
+  double y = *(double*)b;
+  return (x > y) - (x < y);
+}
+
+bool is_blank(char *line) {
+  for (; *line; ++line) {
+    if (*line != ' ' && *line != '\t' && *line != '\n' && *line != '\r') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Nearest-rank percentile of sorted values
+double percentile(double *sorted, size_t n, double p) {
+  size_t rank = ceil(p * n);
+  if (rank < 1) {
+    rank = 1;
+  }
+  return sorted[rank - 1];
+}
+
+int main(int argc, char *argv[]) {
+  FILE *input = stdin;
+  bool two_phase = false;
+  bool anytime = false;
+  size_t target_length = TWO_PHASE_DEFAULT_TARGET_LENGTH;
+  double time_budget = TWO_PHASE_DEFAULT_TIME_BUDGET;
+  size_t max_nodes = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--two-phase")) {
+      two_phase = true;
+    } else if (!strcmp(argv[i], "--anytime")) {
+      anytime = true;
+    } else if (!strncmp(argv[i], "--nodes=", 8)) {
+      max_nodes = strtoull(argv[i] + 8, NULL, 10);
+    } else if (!strncmp(argv[i], "--target=", 9)) {
+      target_length = atoi(argv[i] + 9);
+    } else if (!strncmp(argv[i], "--budget=", 9)) {
+      time_budget = atof(argv[i] + 9);
+    } else {
+      input = fopen(argv[i], "r");
+      if (input == NULL) {
+        fprintf(stderr, "Failed to open %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  if (two_phase || anytime) {
+    prepare_two_phase_solver();
+  }
+  if (!two_phase) {
+    prepare_global_solver();
+  }
+
+  char (*lines)[BATCH_MAX_LINE_LENGTH] = malloc(BATCH_CHUNK_SIZE * BATCH_MAX_LINE_LENGTH);
+  sequence *solutions = malloc(BATCH_CHUNK_SIZE * sizeof(sequence));
+  unsigned char *lower_bounds = malloc(BATCH_CHUNK_SIZE * sizeof(unsigned char));
+  double *chunk_latencies = malloc(BATCH_CHUNK_SIZE * sizeof(double));
+  size_t latencies_capacity = BATCH_CHUNK_SIZE;
+  double *latencies = malloc(latencies_capacity * sizeof(double));
+  size_t num_solves = 0;
+  size_t total_moves = 0;
+
+  BATCH_CANCEL_TOKEN = init_cancel_token();
+  signal(SIGINT, cancel_batch);
+
+  double start = monotonic_seconds();
+  while (!BATCH_CANCEL_TOKEN.cancelled) {
+    size_t num_lines = 0;
+    while (num_lines < BATCH_CHUNK_SIZE && fgets(lines[num_lines], BATCH_MAX_LINE_LENGTH, input)) {
+      num_lines++;
+    }
+    if (!num_lines) {
+      break;
+    }
+    if (num_solves + num_lines > latencies_capacity) {
+      latencies_capacity *= 2;
+      latencies = realloc(latencies, latencies_capacity * sizeof(double));
+    }
+
+    #pragma omp parallel for schedule(dynamic) ordered
+    for (size_t i = 0; i < num_lines; ++i) {
+      SEARCH_CANCEL_TOKEN = &BATCH_CANCEL_TOKEN;
+      bool blank = is_blank(lines[i]);
+      if (!blank) {
+        double solve_start = monotonic_seconds();
+        LocDirCube ldc;
+        locdir_reset(&ldc);
+        locdir_apply_string(&ldc, lines[i]);
+        locdir_realign(&ldc);
+        if (two_phase) {
+          solutions[i] = first_stable_expansion(two_phase_solve(&ldc, target_length, time_budget));
+        } else {
+          // Every thread searches with its own state. The transposition table is not shared between scrambles.
+          IDAstar ida = GLOBAL_SOLVER.ida;
+          IDAstar edge_ida = GLOBAL_SOLVER.edge_ida;
+          ida.table = NULL;
+          edge_ida.table = NULL;
+          if (anytime) {
+            SearchBudget budget = init_search_budget(time_budget, max_nodes);
+            sequence seed = first_stable_expansion(two_phase_solve(&ldc, target_length, BATCH_SEED_BUDGET_FRACTION * time_budget));
+            solutions[i] = global_solve_budgeted(&ida, &edge_ida, &ldc, seed, &budget, false, lower_bounds + i);
+          } else {
+            solutions[i] = global_solve_with(&ida, &edge_ida, &ldc, false);
+          }
+        }
+        chunk_latencies[i] = monotonic_seconds() - solve_start;
+      }
+
+      #pragma omp ordered
+      {
+        if (!blank) {
+          fprint_sequence(stdout, solutions[i]);
+        }
+        if (!blank && solutions[i] != INVALID) {
+          printf("(%d)", sequence_length(solutions[i]));
+          if (anytime && lower_bounds[i] < sequence_length(solutions[i])) {
+            printf(" lower bound %d", lower_bounds[i]);
+          }
+        }
+        printf("\n");
+      }
+    }
+    fflush(stdout);
+
+    for (size_t i = 0; i < num_lines; ++i) {
+      if (!is_blank(lines[i]) && solutions[i] != INVALID) {
+        latencies[num_solves++] = chunk_latencies[i];
+        total_moves += sequence_length(solutions[i]);
+      }
+    }
+  }
+  double elapsed = monotonic_seconds() - start;
+
+  if (num_solves) {
+    qsort(latencies, num_solves, sizeof(double), cmp_double);
+    fprintf(stderr, "%zu solves in %g seconds (%g solves/s)\n", num_solves, elapsed, num_solves / elapsed);
+    fprintf(stderr, "Average solution length: %g moves\n", total_moves / (double) num_solves);
+    fprintf(stderr, "Latency p50 = %g s, p99 = %g s, max = %g s\n",
+      percentile(latencies, num_solves, 0.5),
+      percentile(latencies, num_solves, 0.99),
+      latencies[num_solves - 1]
+    );
+  }
+
+  free(lines);
+  free(solutions);
+  free(lower_bounds);
+  free(chunk_latencies);
+  free(latencies);
+  if (two_phase || anytime) {
+    free_two_phase_solver();
+  }
+  if (!two_phase) {
+    free_global_solver();
+  }
+  if (input != stdin) {
+    fclose(input);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,736 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "stdbool.h"
+#include "math.h"
+
+#include "prng.c"
+#include "cube.c"
+#include "moves.c"
+#include "sequence.c"
+#include "locdir.c"
+#include "tablebase.c"
+#include "goalsphere.c"
+#include "ida_star.c"
+#include "solution_cache.c"
+#include "global_solver.c"
+
+#ifdef _OPENMP
+#include "omp.h"
+#endif
+
+/*
+Reproducible benchmark of the solvers on the fixed scramble corpora in benchmarks/.
+
+Every corpus line holds the optimal number of moves of the case followed by its scramble.
+The operations of a suite run over every case of its corpus and their results are checked against the recorded depths.
+Timings are written per operation and depth as JSON lines so that the results of different builds can be compared.
+
+Usage: ./benchmark.out [--suite=<name>] [--repeat=<count>] [--output=<file>] [--compare=<file>]
+       ./benchmark.out --generate [--suite=<name>]
+The suites are cross, xcross, edges, pll, full and deep. Without --suite all of them run.
+The cross table is built on the fly. The other suites need the tables from tabulate.c.
+Each case runs --repeat times (3 by default) and the fastest run counts.
+With --compare the timings are checked against an earlier result file and slowdowns beyond BENCHMARK_TOLERANCE fail the run.
+
+--generate rewrites the corpora from BENCHMARK_SEED. The cross depths come from the cross tablebase.
+The other depths come from a plain IDA* search with small tables that are not used by the benchmarked solvers.
+The PLL depths are the lengths of the shortest algorithms listed by pll_html.c.
+The deep cases continue the full ones past the reach of that search. Their depths come from the global solver instead,
+which takes hours over the candidates, so the deep corpus is only rewritten by --generate --suite=deep.
+Bump BENCHMARK_CORPUS_VERSION when regenerating because the old results no longer apply.
+The depths are in the slice turn metric. Builds with scissor moves only check that the results are not longer.
+*/
+
+#define BENCHMARK_CORPUS_VERSION (1)
+#define BENCHMARK_SEED (20240611)
+
+#define BENCHMARK_DEFAULT_REPEAT (3)
+#define BENCHMARK_DEFAULT_OUTPUT "benchmark_results.jsonl"
+
+// Relative slowdown of the mean time of an operation at a depth that counts as a regression
+#define BENCHMARK_TOLERANCE (0.25)
+
+#define BENCHMARK_MAX_LINE_LENGTH (256)
+#define BENCHMARK_MAX_DEPTH (SEQUENCE_MAX_LENGTH)
+#define BENCHMARK_MAX_CASES_PER_DEPTH (32)
+
+// Search nodes that the global solver may spend on a candidate for the deep corpus. Harder candidates are skipped so that
+// the deep suite stays runnable. Nodes rather than seconds keep --generate reproducible.
+#define BENCHMARK_DEEP_MAX_NODES (BUDGET_PLACEHOLDER)
+
+typedef struct {
+  unsigned char depth;
+  char scramble[BENCHMARK_MAX_LINE_LENGTH];
+  LocDirCube ldc;
+} BenchmarkCase;
+
+typedef struct {
+  BenchmarkCase *cases;
+  size_t num_cases;
+} Corpus;
+
+enum benchmark_check {
+  // The result is the optimal depth
+  CHECK_EXACT,
+  // The result is at most the optimal depth
+  CHECK_LOWER_BOUND,
+};
+
+typedef struct {
+  const char *suite;
+  const char *name;
+  // Number of moves found or proven for the case
+  unsigned char (*run)(LocDirCube *ldc);
+  enum benchmark_check check;
+  // Cases of other depths are skipped. NULL for every depth.
+  bool (*applies)(unsigned char depth);
+} BenchmarkOperation;
+
+typedef struct {
+  const char *name;
+  // Scrambles of this many face turns and up are measured and shallower cases are left to the other suites
+  int min_depth;
+  // Scrambles of up to this many face turns are measured to fill the depths
+  int max_scramble_length;
+  // Measured depth of a scramble for --generate
+  unsigned char (*depth)(LocDirCube *ldc);
+  size_t cases_per_depth;
+  size_t num_attempts;
+} BenchmarkSuite;
+
+// Tables of the independent search of --generate
+enum oracle_table {
+  ORACLE_CORNER_ORIENTATION,
+  ORACLE_CORNER_PERMUTATION,
+  ORACLE_FOUR_CORNERS,
+  ORACLE_EDGE_ORIENTATION,
+  ORACLE_FIRST_4_EDGES,
+  ORACLE_MIDDLE_4_EDGES,
+  ORACLE_LAST_4_EDGES,
+  NUM_ORACLE_TABLES,
+};
+
+typedef struct {
+  Nibblebase cross;
+  Nibblebase xcross;
+  Nibblebase oracle[NUM_ORACLE_TABLES];
+  bool has_cross;
+  bool has_xcross;
+  bool has_global;
+  bool has_oracle;
+} BenchmarkTables;
+
+BenchmarkTables BENCHMARK_TABLES;
+
+double monotonic_seconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+void prepare_cross_table() {
+  if (BENCHMARK_TABLES.has_cross) {
+    return;
+  }
+  fprintf(stderr, "Building tablebase for cross...\n");
+  BENCHMARK_TABLES.cross = init_nibblebase(LOCDIR_CROSS_INDEX_SPACE, &locdir_cross_index);
+  LocDirCube ldc;
+  locdir_reset_cross(&ldc);
+  populate_nibblebase(&BENCHMARK_TABLES.cross, &ldc);
+  BENCHMARK_TABLES.has_cross = true;
+}
+
+// Returns false if the table has not been created by tabulate.c
+bool prepare_xcross_table() {
+  if (BENCHMARK_TABLES.has_xcross) {
+    return true;
+  }
+  #ifdef SCISSORS_ENABLED
+  FILE *fptr = fopen("./tables/xcross_scissors.bin", "rb");
+  #else
+  FILE *fptr = fopen("./tables/xcross.bin", "rb");
+  #endif
+  if (fptr == NULL) {
+    return false;
+  }
+  fprintf(stderr, "Loading tablebase for xcross...\n");
+  BENCHMARK_TABLES.xcross = init_nibblebase(LOCDIR_XCROSS_INDEX_SPACE, &locdir_xcross_index);
+  size_t tablebase_size = (LOCDIR_XCROSS_INDEX_SPACE + 1)/2;
+  size_t num_read = fread(BENCHMARK_TABLES.xcross.octets, sizeof(unsigned char), tablebase_size, fptr);
+  if (num_read != tablebase_size) {
+    fprintf(stderr, "Failed to load data. Only %zu of %zu read.\n", num_read, tablebase_size);
+    exit(EXIT_FAILURE);
+  }
+  fclose(fptr);
+  BENCHMARK_TABLES.has_xcross = true;
+  return true;
+}
+
+void prepare_global_tables() {
+  if (!BENCHMARK_TABLES.has_global) {
+    prepare_global_solver();
+    BENCHMARK_TABLES.has_global = true;
+  }
+}
+
+bool prepare_suite(const char *suite) {
+  if (!strcmp(suite, "cross")) {
+    prepare_cross_table();
+    return true;
+  }
+  if (!strcmp(suite, "xcross")) {
+    return prepare_xcross_table();
+  }
+  prepare_global_tables();
+  return true;
+}
+
+unsigned char goal_shell_depth() {
+  return GLOBAL_SOLVER.goal.num_sets - 1;
+}
+
+bool inside_goal(unsigned char depth) {
+  return depth <= goal_shell_depth();
+}
+
+bool outside_goal(unsigned char depth) {
+  return depth > goal_shell_depth();
+}
+
+bool inside_edge_goal(unsigned char depth) {
+  return depth < GLOBAL_SOLVER.edge_goal.num_sets;
+}
+
+unsigned char run_cross_solve(LocDirCube *ldc) {
+  return sequence_length(nibble_solve(&BENCHMARK_TABLES.cross, ldc, &is_better));
+}
+
+unsigned char run_xcross_solve(LocDirCube *ldc) {
+  return sequence_length(nibble_solve(&BENCHMARK_TABLES.xcross, ldc, &is_better));
+}
+
+unsigned char run_edge_goalsphere_solve(LocDirCube *ldc) {
+  return sequence_length(goalsphere_solve(&GLOBAL_SOLVER.edge_goal, ldc, 0, &is_better));
+}
+
+unsigned char run_goalsphere_solve(LocDirCube *ldc) {
+  return sequence_length(goalsphere_solve(&GLOBAL_SOLVER.goal, ldc, 0, &is_better));
+}
+
+// The bound on the first steps plus the goal sphere
+unsigned char run_global_lower_bound(LocDirCube *ldc) {
+  return global_lower_bound(ldc) + goal_shell_depth();
+}
+
+unsigned char run_global_solve(LocDirCube *ldc) {
+  return sequence_length(global_solve(ldc));
+}
+
+void prepare_oracle() {
+  if (BENCHMARK_TABLES.has_oracle) {
+    return;
+  }
+  fprintf(stderr, "Building tablebases for the independent search...\n");
+  Nibblebase *oracle = BENCHMARK_TABLES.oracle;
+  oracle[ORACLE_CORNER_ORIENTATION] = init_nibblebase(LOCDIR_CORNER_ORIENTATION_INDEX_SPACE, &locdir_corner_orientation_index);
+  oracle[ORACLE_CORNER_PERMUTATION] = init_nibblebase(LOCDIR_CORNER_PERMUTATION_INDEX_SPACE, &locdir_corner_permutation_index);
+  oracle[ORACLE_FOUR_CORNERS] = init_nibblebase(LOCDIR_FOUR_CORNER_INDEX_SPACE, &locdir_four_corner_index);
+  oracle[ORACLE_EDGE_ORIENTATION] = init_nibblebase(LOCDIR_EDGE_ORIENTATION_INDEX_SPACE, &locdir_edge_orientation_index);
+  oracle[ORACLE_FIRST_4_EDGES] = init_nibblebase(LOCDIR_FIRST_4_EDGE_INDEX_SPACE, &locdir_first_4_edge_index);
+  oracle[ORACLE_MIDDLE_4_EDGES] = init_nibblebase(LOCDIR_MIDDLE_4_EDGE_INDEX_SPACE, &locdir_middle_4_edge_index);
+  oracle[ORACLE_LAST_4_EDGES] = init_nibblebase(LOCDIR_LAST_4_EDGE_INDEX_SPACE, &locdir_last_4_edge_index);
+  for (size_t i = 0; i < NUM_ORACLE_TABLES; ++i) {
+    LocDirCube ldc;
+    locdir_reset(&ldc);
+    populate_nibblebase(oracle + i, &ldc);
+  }
+  BENCHMARK_TABLES.has_oracle = true;
+}
+
+unsigned char oracle_estimate(LocDirCube *ldc, enum oracle_table first, enum oracle_table last) {
+  unsigned char estimate = 0;
+  for (size_t i = first; i <= last; ++i) {
+    unsigned char depth = nibble_depth(BENCHMARK_TABLES.oracle + i, ldc);
+    estimate = depth > estimate ? depth : estimate;
+  }
+  return estimate;
+}
+
+unsigned char full_oracle_estimator(LocDirCube *ldc) {
+  return oracle_estimate(ldc, ORACLE_CORNER_ORIENTATION, ORACLE_LAST_4_EDGES);
+}
+
+unsigned char edge_oracle_estimator(LocDirCube *ldc) {
+  return oracle_estimate(ldc, ORACLE_EDGE_ORIENTATION, ORACLE_LAST_4_EDGES);
+}
+
+unsigned char oracle_depth(LocDirCube *ldc, bool (*is_solved)(LocDirCube*), unsigned char (*estimator)(LocDirCube*)) {
+  IDAstar ida = init_ida_star(is_solved, estimator);
+  ida_star_solve(&ida, ldc, 0);
+  return ida.num_moves;
+}
+
+unsigned char cross_depth(LocDirCube *ldc) {
+  return nibble_depth(&BENCHMARK_TABLES.cross, ldc);
+}
+
+size_t SOLVED_XCROSS_INDEX;
+
+bool xcross_solved(LocDirCube *ldc) {
+  return locdir_xcross_index(ldc) == SOLVED_XCROSS_INDEX;
+}
+
+// The cross is a lower bound for the extended cross
+unsigned char xcross_depth(LocDirCube *ldc) {
+  return oracle_depth(ldc, xcross_solved, cross_depth);
+}
+
+// Moves needed to solve the edges while ignoring the corners
+unsigned char edge_depth(LocDirCube *ldc) {
+  return oracle_depth(ldc, locdir_edges_solved, edge_oracle_estimator);
+}
+
+unsigned char full_depth(LocDirCube *ldc) {
+  return oracle_depth(ldc, locdir_centerless_solved, full_oracle_estimator);
+}
+
+// Depth of a deep case or UNKNOWN if the global solver does not settle it within BENCHMARK_DEEP_MAX_NODES
+unsigned char deep_depth(LocDirCube *ldc) {
+  SearchBudget budget = init_search_budget(0, BENCHMARK_DEEP_MAX_NODES);
+  unsigned char lower_bound;
+  sequence solution = global_solve_budgeted(&GLOBAL_SOLVER.ida, &GLOBAL_SOLVER.edge_ida, ldc, INVALID, &budget, false, &lower_bound);
+  return solution == INVALID ? UNKNOWN : sequence_length(solution);
+}
+
+// The depths of the corpora come from other tables than the ones benchmarked
+void prepare_generator(const char *suite) {
+  if (!strcmp(suite, "cross")) {
+    prepare_cross_table();
+  } else if (!strcmp(suite, "xcross")) {
+    prepare_cross_table();
+    LocDirCube solved;
+    locdir_reset(&solved);
+    SOLVED_XCROSS_INDEX = locdir_xcross_index(&solved);
+  } else if (!strcmp(suite, "deep")) {
+    prepare_global_tables();
+  } else if (strcmp(suite, "pll")) {
+    prepare_oracle();
+  }
+}
+
+const BenchmarkOperation BENCHMARK_OPERATIONS[] = {
+  {"cross", "nibble_solve", run_cross_solve, CHECK_EXACT, NULL},
+  {"xcross", "nibble_solve", run_xcross_solve, CHECK_EXACT, NULL},
+  {"edges", "goalsphere_solve", run_edge_goalsphere_solve, CHECK_EXACT, inside_edge_goal},
+  // Edge depths beyond the goal sphere are exactly what the lower bound of the global solver is made of
+  {"edges", "global_lower_bound", run_global_lower_bound, CHECK_EXACT, outside_goal},
+  {"pll", "global_lower_bound", run_global_lower_bound, CHECK_LOWER_BOUND, outside_goal},
+  {"pll", "global_solve", run_global_solve, CHECK_EXACT, NULL},
+  {"full", "goalsphere_solve", run_goalsphere_solve, CHECK_EXACT, inside_goal},
+  {"full", "global_lower_bound", run_global_lower_bound, CHECK_LOWER_BOUND, outside_goal},
+  {"full", "global_solve", run_global_solve, CHECK_EXACT, NULL},
+  {"deep", "global_lower_bound", run_global_lower_bound, CHECK_LOWER_BOUND, outside_goal},
+  {"deep", "global_solve", run_global_solve, CHECK_EXACT, NULL},
+};
+
+#define NUM_BENCHMARK_OPERATIONS (sizeof(BENCHMARK_OPERATIONS) / sizeof(BenchmarkOperation))
+
+// Shortest slice turn algorithms from pll_html.c. The PLL corpus is made of their inverses.
+const char *BENCHMARK_PLL_ALGORITHMS[] = {
+  "f' U f' R2 f U' f' R2 f2",  // Aa
+  "r2 f2 R F R' B2 R F' R",  // Ab
+  "U M U2 r' U R' F2 r F' R' M' F2 R2",  // F
+  "U' f2 M2 U R2 U' R2 D R2 D' r2 f2",  // Ga
+  "U R2 F2 U R2 D' R2 D f2 D' S2 R2",  // Gb
+  "U F2 M2 D' r2 U r2 U' r2 D R2 F2",  // Gc
+  "U' R2 f2 D' r2 D r2 U' F2 D S2 R2",  // Gd
+  "l2 U R U' R f2 R' U R f2",  // Ja
+  "R2 B U f' U2 F R' F R F2",  // Jb
+  "U F U2 S R f' R' F U2 F2 U' F R",  // Ra
+  "U F R U' R2 U2 R F' r' F M' U2 R",  // Rb
+  "U F2 U' F2 D R2 f2 D f2 D' R2",  // T
+  "F U' f r2 F' R S' U' f r2 F' R f'",  // E
+  "R U2 f2 R f D' f D2 F' R F E2 r'",  // Na
+  "R' U2 F2 r' D' r F' D2 f D' f' E2 r",  // Nb
+  "R' U R' U' R D' R' D R' f2 D' f2 U R2",  // V
+  "R' U' R F2 R' U R U F2 U' F2 U' F2",  // Y
+  "M2 U M2 U2 M2 U M2",  // H
+  "F2 U' M' U2 M U' F2",  // Ua
+  "F2 U M' U2 M U F2",  // Ub
+  "M S2 M' D' M2 u M2",  // Z
+};
+
+#define NUM_BENCHMARK_PLL_ALGORITHMS (sizeof(BENCHMARK_PLL_ALGORITHMS) / sizeof(char*))
+
+const BenchmarkSuite BENCHMARK_SUITES[] = {
+  {"cross", 1, 10, cross_depth, 16, 10000},
+  // Deeper cases take the independent searches minutes each
+  {"xcross", 1, 14, xcross_depth, 4, 300},
+  {"edges", 1, 10, edge_depth, 4, 200},
+  {"pll", 0, 0, NULL, 0, 0},
+  {"full", 1, 10, full_depth, 3, 100},
+  // Full cube cases beyond the reach of the independent search. Their depths come from the global solver.
+  {"deep", 11, 18, deep_depth, 3, DEEP_NUM_ATTEMPTS},
+};
+
+#define NUM_BENCHMARK_SUITES (sizeof(BENCHMARK_SUITES) / sizeof(BenchmarkSuite))
+
+void corpus_path(char *path, const char *suite) {
+  sprintf(path, "./benchmarks/%s.txt", suite);
+}
+
+Corpus load_corpus(const char *suite) {
+  char path[BENCHMARK_MAX_LINE_LENGTH];
+  corpus_path(path, suite);
+  FILE *fptr = fopen(path, "r");
+  if (fptr == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+  Corpus corpus;
+  size_t capacity = 64;
+  corpus.cases = malloc(capacity * sizeof(BenchmarkCase));
+  corpus.num_cases = 0;
+  char line[BENCHMARK_MAX_LINE_LENGTH];
+  int version = 0;
+  while (fgets(line, BENCHMARK_MAX_LINE_LENGTH, fptr)) {
+    if (line[0] == '#') {
+      sscanf(line, "# version %d", &version);
+      continue;
+    }
+    int depth;
+    int offset;
+    if (sscanf(line, "%d %n", &depth, &offset) != 1) {
+      continue;
+    }
+    if (corpus.num_cases == capacity) {
+      capacity *= 2;
+      corpus.cases = realloc(corpus.cases, capacity * sizeof(BenchmarkCase));
+    }
+    BenchmarkCase *it = corpus.cases + corpus.num_cases++;
+    it->depth = depth;
+    strcpy(it->scramble, line + offset);
+    it->scramble[strcspn(it->scramble, "\r\n")] = '\0';
+    locdir_reset(&it->ldc);
+    locdir_apply_string(&it->ldc, it->scramble);
+    locdir_realign(&it->ldc);
+  }
+  fclose(fptr);
+  if (version != BENCHMARK_CORPUS_VERSION) {
+    fprintf(stderr, "%s is version %d but version %d is expected.\n", path, version, BENCHMARK_CORPUS_VERSION);
+    exit(EXIT_FAILURE);
+  }
+  return corpus;
+}
+
+void free_corpus(Corpus *corpus) {
+  free(corpus->cases);
+}
+
+bool result_matches(enum benchmark_check check, unsigned char result, unsigned char depth) {
+  #ifdef SCISSORS_ENABLED
+  // Scissor moves only make things shorter. Lower bounds may then exceed the slice turn depth too.
+  return check == CHECK_LOWER_BOUND || result <= depth;
+  #else
+  return check == CHECK_LOWER_BOUND ? result <= depth : result == depth;
+  #endif
+}
+
+typedef struct {
+  char suite[64];
+  char operation[64];
+  int depth;
+  double mean_seconds;
+} BaselineRow;
+
+// Returns the rows of an earlier result file. Lines that are not rows are skipped.
+BaselineRow *load_baseline(const char *path, size_t *num_rows) {
+  FILE *fptr = fopen(path, "r");
+  if (fptr == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+  size_t capacity = 64;
+  BaselineRow *rows = malloc(capacity * sizeof(BaselineRow));
+  *num_rows = 0;
+  char line[1024];
+  while (fgets(line, sizeof(line), fptr)) {
+    BaselineRow row;
+    size_t num_cases;
+    int num_matched = sscanf(
+      line,
+      "{\"suite\": \"%63[^\"]\", \"operation\": \"%63[^\"]\", \"depth\": %d, \"cases\": %zu, \"mean_seconds\": %lf",
+      row.suite,
+      row.operation,
+      &row.depth,
+      &num_cases,
+      &row.mean_seconds
+    );
+    if (num_matched != 5) {
+      continue;
+    }
+    if (*num_rows == capacity) {
+      capacity *= 2;
+      rows = realloc(rows, capacity * sizeof(BaselineRow));
+    }
+    rows[(*num_rows)++] = row;
+  }
+  fclose(fptr);
+  return rows;
+}
+
+BaselineRow *find_baseline(BaselineRow *rows, size_t num_rows, const char *suite, const char *operation, int depth) {
+  for (size_t i = 0; i < num_rows; ++i) {
+    if (!strcmp(rows[i].suite, suite) && !strcmp(rows[i].operation, operation) && rows[i].depth == depth) {
+      return rows + i;
+    }
+  }
+  return NULL;
+}
+
+// Runs the operation on every case of the corpus. Returns the number of results that did not match their depth.
+size_t run_operation(const BenchmarkOperation *op, Corpus *corpus, size_t repeat, FILE *output, BaselineRow *baseline, size_t num_baseline_rows, size_t *num_regressions) {
+  size_t num_mismatches = 0;
+  for (int depth = 0; depth <= BENCHMARK_MAX_DEPTH; ++depth) {
+    if (op->applies != NULL && !op->applies(depth)) {
+      continue;
+    }
+    size_t num_cases = 0;
+    size_t depth_mismatches = 0;
+    double total = 0;
+    double max = 0;
+    for (size_t i = 0; i < corpus->num_cases; ++i) {
+      BenchmarkCase *it = corpus->cases + i;
+      if (it->depth != depth) {
+        continue;
+      }
+      double fastest = INFINITY;
+      for (size_t j = 0; j < repeat; ++j) {
+        double start = monotonic_seconds();
+        unsigned char result = op->run(&it->ldc);
+        double took = monotonic_seconds() - start;
+        fastest = took < fastest ? took : fastest;
+        if (j == 0 && !result_matches(op->check, result, depth)) {
+          fprintf(stderr, "%s %s: expected %d but got %d for %s\n", op->suite, op->name, depth, result, it->scramble);
+          depth_mismatches++;
+        }
+      }
+      num_cases++;
+      total += fastest;
+      max = fastest > max ? fastest : max;
+    }
+    if (!num_cases) {
+      continue;
+    }
+    double mean = total / num_cases;
+    fprintf(
+      output,
+      "{\"suite\": \"%s\", \"operation\": \"%s\", \"depth\": %d, \"cases\": %zu, \"mean_seconds\": %g, \"max_seconds\": %g, \"total_seconds\": %g, \"mismatches\": %zu}\n",
+      op->suite,
+      op->name,
+      depth,
+      num_cases,
+      mean,
+      max,
+      total,
+      depth_mismatches
+    );
+    fflush(output);
+    fprintf(stderr, "%s %s depth %d: %zu cases, mean %g ms, max %g ms", op->suite, op->name, depth, num_cases, 1e3 * mean, 1e3 * max);
+    BaselineRow *row = find_baseline(baseline, num_baseline_rows, op->suite, op->name, depth);
+    if (row != NULL && row->mean_seconds > 0) {
+      double ratio = mean / row->mean_seconds;
+      fprintf(stderr, ", %.2fx baseline", ratio);
+      if (ratio > 1 + BENCHMARK_TOLERANCE) {
+        fprintf(stderr, " REGRESSION");
+        (*num_regressions)++;
+      }
+    }
+    fprintf(stderr, "\n");
+    num_mismatches += depth_mismatches;
+  }
+  return num_mismatches;
+}
+
+// Writes a corpus line for every scramble with the depth of the suite
+void generate_corpus(const BenchmarkSuite *suite) {
+  char path[BENCHMARK_MAX_LINE_LENGTH];
+  corpus_path(path, suite->name);
+  FILE *fptr = fopen(path, "w");
+  if (fptr == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+  fprintf(fptr, "# version %d\n", BENCHMARK_CORPUS_VERSION);
+  fprintf(fptr, "# Optimal slice turn depth of each %s case followed by its scramble\n", suite->name);
+
+  if (!strcmp(suite->name, "pll")) {
+    for (size_t i = 0; i < NUM_BENCHMARK_PLL_ALGORITHMS; ++i) {
+      sequence algorithm = parse((char*) BENCHMARK_PLL_ALGORITHMS[i]);
+      fprintf(fptr, "%d ", sequence_length(algorithm));
+      fprint_sequence(fptr, invert(algorithm));
+      fprintf(fptr, "\n");
+    }
+    fclose(fptr);
+    return;
+  }
+
+  // Every corpus has its own stream so that they can be regenerated one at a time
+  Prng prng = init_prng(BENCHMARK_SEED);
+  sequence scrambles[BENCHMARK_MAX_DEPTH + 1][BENCHMARK_MAX_CASES_PER_DEPTH];
+  size_t num_scrambles[BENCHMARK_MAX_DEPTH + 1] = {0};
+  for (size_t attempt = 0; attempt < suite->num_attempts; ++attempt) {
+    Cube solved;
+    reset(&solved);
+    int length = suite->min_depth + attempt % (suite->max_scramble_length - suite->min_depth + 1);
+    sequence scramble = make_scramble(&solved, length, &prng);
+    LocDirCube ldc;
+    locdir_reset(&ldc);
+    locdir_apply_sequence(&ldc, scramble);
+    unsigned char depth = suite->depth(&ldc);
+    // Solved cases only measure the overhead so every suite starts at depth 1 or later
+    if (depth < suite->min_depth || depth > BENCHMARK_MAX_DEPTH || num_scrambles[depth] >= suite->cases_per_depth) {
+      continue;
+    }
+    bool duplicate = false;
+    for (size_t i = 0; i < num_scrambles[depth]; ++i) {
+      duplicate = duplicate || scrambles[depth][i] == scramble;
+    }
+    if (!duplicate) {
+      scrambles[depth][num_scrambles[depth]++] = scramble;
+    }
+  }
+  for (int depth = 0; depth <= BENCHMARK_MAX_DEPTH; ++depth) {
+    for (size_t i = 0; i < num_scrambles[depth]; ++i) {
+      fprintf(fptr, "%d ", depth);
+      fprint_sequence(fptr, scrambles[depth][i]);
+      fprintf(fptr, "\n");
+    }
+  }
+  fclose(fptr);
+}
+
+int main(int argc, char *argv[]) {
+  const char *only_suite = NULL;
+  const char *output_path = BENCHMARK_DEFAULT_OUTPUT;
+  const char *baseline_path = NULL;
+  size_t repeat = BENCHMARK_DEFAULT_REPEAT;
+  bool generate = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--generate")) {
+      generate = true;
+    } else if (!strncmp(argv[i], "--suite=", 8)) {
+      only_suite = argv[i] + 8;
+    } else if (!strncmp(argv[i], "--repeat=", 9)) {
+      repeat = atoi(argv[i] + 9);
+    } else if (!strncmp(argv[i], "--output=", 9)) {
+      output_path = argv[i] + 9;
+    } else if (!strncmp(argv[i], "--compare=", 10)) {
+      baseline_path = argv[i] + 10;
+    } else {
+      fprintf(stderr, "Unrecognized argument %s\n", argv[i]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (repeat < 1) {
+    repeat = 1;
+  }
+
+  if (generate) {
+    #ifdef SCISSORS_ENABLED
+    fprintf(stderr, "The corpora are in the slice turn metric. Generate them without scissor moves.\n");
+    exit(EXIT_FAILURE);
+    #endif
+    for (size_t i = 0; i < NUM_BENCHMARK_SUITES; ++i) {
+      if (only_suite != NULL && strcmp(only_suite, BENCHMARK_SUITES[i].name)) {
+        continue;
+      }
+      // The global solver takes hours over the deep corpus so it is only regenerated when asked for by name
+      if (only_suite == NULL && !strcmp(BENCHMARK_SUITES[i].name, "deep")) {
+        continue;
+      }
+      prepare_generator(BENCHMARK_SUITES[i].name);
+      fprintf(stderr, "Generating corpus for %s...\n", BENCHMARK_SUITES[i].name);
+      generate_corpus(BENCHMARK_SUITES + i);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  size_t num_baseline_rows = 0;
+  BaselineRow *baseline = NULL;
+  if (baseline_path != NULL) {
+    baseline = load_baseline(baseline_path, &num_baseline_rows);
+  }
+
+  FILE *output = fopen(output_path, "w");
+  if (output == NULL) {
+    fprintf(stderr, "Failed to open %s\n", output_path);
+    exit(EXIT_FAILURE);
+  }
+  #ifdef _OPENMP
+  int num_threads = omp_get_max_threads();
+  #else
+  int num_threads = 1;
+  #endif
+  #ifdef SCISSORS_ENABLED
+  const char *metric = "scissors";
+  #else
+  const char *metric = "slice";
+  #endif
+  fprintf(
+    output,
+    "{\"corpus_version\": %d, \"metric\": \"%s\", \"threads\": %d, \"repeat\": %zu, \"timestamp\": %lld}\n",
+    BENCHMARK_CORPUS_VERSION,
+    metric,
+    num_threads,
+    repeat,
+    (long long) time(NULL)
+  );
+
+  size_t num_mismatches = 0;
+  size_t num_regressions = 0;
+  for (size_t i = 0; i < NUM_BENCHMARK_SUITES; ++i) {
+    const char *suite = BENCHMARK_SUITES[i].name;
+    if (only_suite != NULL && strcmp(only_suite, suite)) {
+      continue;
+    }
+    if (!prepare_suite(suite)) {
+      fprintf(stderr, "Skipping %s without its tables.\n", suite);
+      continue;
+    }
+    Corpus corpus = load_corpus(suite);
+    for (size_t j = 0; j < NUM_BENCHMARK_OPERATIONS; ++j) {
+      if (!strcmp(BENCHMARK_OPERATIONS[j].suite, suite)) {
+        num_mismatches += run_operation(BENCHMARK_OPERATIONS + j, &corpus, repeat, output, baseline, num_baseline_rows, &num_regressions);
+      }
+    }
+    free_corpus(&corpus);
+  }
+  fclose(output);
+  free(baseline);
+
+  if (BENCHMARK_TABLES.has_cross) {
+    free_nibblebase(&BENCHMARK_TABLES.cross);
+  }
+  if (BENCHMARK_TABLES.has_xcross) {
+    free_nibblebase(&BENCHMARK_TABLES.xcross);
+  }
+  if (BENCHMARK_TABLES.has_global) {
+    free_global_solver();
+  }
+  if (BENCHMARK_TABLES.has_oracle) {
+    for (size_t i = 0; i < NUM_ORACLE_TABLES; ++i) {
+      free_nibblebase(BENCHMARK_TABLES.oracle + i);
+    }
+  }
+
+  if (num_mismatches) {
+    fprintf(stderr, "%zu results did not match the corpus.\n", num_mismatches);
+  }
+  if (num_regressions) {
+    fprintf(stderr, "%zu timings regressed by more than %g%%.\n", num_regressions, 100 * BENCHMARK_TOLERANCE);
+  }
+  return num_mismatches || num_regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -3,6 +3,7 @@
 #include "time.h"
 #include "stdbool.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
@@ -10,7 +11,7 @@
 #include "tablebase.c"
 
 int main() {
-  srand(time(NULL));
+  Prng prng = init_prng(time(NULL));
 
   Nibblebase tablebase = init_nibblebase(LOCDIR_CROSS_INDEX_SPACE, &locdir_cross_index);
   LocDirCube ldc;
@@ -26,7 +27,7 @@ int main() {
   for (;;) {
     locdir_reset_cross(&ldc);
     cube = to_cube(&ldc);
-    sequence s = make_scramble(&cube, 8 + rand() % 4);
+    sequence s = make_scramble(&cube, 8 + prng_below(&prng, 4), &prng);
     locdir_apply_sequence(&ldc, s);
     unsigned char depth = nibble_depth(&tablebase, &ldc);
 
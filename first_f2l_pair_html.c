@@ -4,6 +4,7 @@
 #include "stdbool.h"
 #include "assert.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
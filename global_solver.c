@@ -1,4 +1,50 @@
+// Set to e.g. (ORDER_BY_ESTIMATE | ORDER_BY_KILLERS) to find the first solution faster.
+// The solution is then no longer the first one in move priority order.
+#define GLOBAL_MOVE_ORDERING (0)
+
+// Also probe the tables with the inverse position, which is equally far from solved
+#define GLOBAL_INVERSE_LOOKUPS (false)
+
+// Number of whole-cube rotations (identity first) that the position is conjugated by before probing the tables
+#define GLOBAL_NUM_CONJUGATIONS (1)
+
+// Probe small cache-resident tables before the large ones
+#define GLOBAL_PREFILTER (true)
+
+// Look positions that the tables place within reach of the goal sphere up in all of its layers.
+// Positions outside are at least one move from the shell and any layer is accepted as the goal.
+#define GLOBAL_EXACT_GOAL (true)
+
+// Use a goal sphere that stores one representative per class of positions related by whole-cube rotations and inversion.
+// It is created by create_symmetric_sphere in tabulate.c. Lookups are slower but the sphere is up to 48 times smaller.
+#define GLOBAL_SYMMETRIC_GOAL (false)
+
+#if GLOBAL_SYMMETRIC_GOAL
+#define GLOBAL_GOAL_HASH locdir_symmetric_inverse_hash
+#else
+#define GLOBAL_GOAL_HASH locdir_centerless_hash
+#endif
+
+// Memory budget in bytes for the transposition table of the main search. Zero disables the table.
+#define GLOBAL_TRANSPOSITION_TABLE_BYTES (0)
+
+// Number of solutions to remember across solves of symmetric positions. Zero disables the cache.
+#define GLOBAL_SOLUTION_CACHE_ENTRIES (0)
+
+// Where the solution cache is kept between runs
+#ifdef SCISSORS_ENABLED
+#define GLOBAL_SOLUTION_CACHE_PATH "./tables/solution_cache_scissors.bin"
+#else
+#define GLOBAL_SOLUTION_CACHE_PATH "./tables/solution_cache.bin"
+#endif
+
+// Write the statistics of every solve to stderr as JSON lines. Enable IDA_STAR_INSTRUMENTATION for the statistics per bound.
+#define GLOBAL_JSON_STATS (false)
+
 typedef struct {
+  Nibblebase edge_orientation;
+  Nibblebase corner_orientation;
+  Nibblebase corner_permutation;
   Nibblebase first;
   Nibblebase last;
   Nibblebase corners;
@@ -6,23 +52,70 @@ typedef struct {
   GoalSphere edge_goal;
   IDAstar ida;
   IDAstar edge_ida;
+  TranspositionTable table;
+  SolutionCache cache;
+  size_t num_conjugations;
 } Solver;
 
 Solver GLOBAL_SOLVER;
 
-unsigned char global_estimator(LocDirCube *ldc) {
-  unsigned char depth = get_nibble(&GLOBAL_SOLVER.first, (*GLOBAL_SOLVER.first.index_func)(ldc));
-  unsigned char last_depth = get_nibble(&GLOBAL_SOLVER.last, (*GLOBAL_SOLVER.last.index_func)(ldc));
-  unsigned char corners_depth = get_nibble(&GLOBAL_SOLVER.corners, (*GLOBAL_SOLVER.corners.index_func)(ldc));
-
-  if (last_depth > depth) {
-    depth = last_depth;
+// Stages of the global estimator from cheapest to most expensive
+enum global_stage {
+  EDGE_ORIENTATION_STAGE,
+  CORNER_ORIENTATION_STAGE,
+  CORNER_PERMUTATION_STAGE,
+  CORNERS_STAGE,
+  FIRST_EDGES_STAGE,
+  LAST_EDGES_STAGE,
+  GOAL_SPHERE_STAGE,
+  NUM_GLOBAL_STAGES,
+};
+
+const char *GLOBAL_STAGE_NAMES[] = {
+  "edge orientation",
+  "corner orientation",
+  "corner permutation",
+  "corners",
+  "first 7 edges",
+  "last 7 edges",
+  "goal sphere",
+};
+
+// Raises the depth to that of a stage and reports if the node is cut off
+static inline bool global_stage(unsigned char *depth, unsigned char stage_depth, enum global_stage stage, unsigned int cutoff_depth, size_t *probes, size_t *cuts) {
+  probes[stage]++;
+  if (stage_depth > *depth) {
+    *depth = stage_depth;
   }
-  if (corners_depth > depth) {
-    depth = corners_depth;
+  if (*depth > cutoff_depth) {
+    cuts[stage]++;
+    return true;
   }
+  return false;
+}
 
+// Probes the tables cheapest first and returns as soon as the estimate exceeds the limit.
+// The index functions are called directly instead of through the tablebases so that the specialized kernels can inline them.
+// They must match the ones given to init_nibblebase in prepare_global_solver.
+unsigned char global_cascade(LocDirCube *ldc, unsigned char limit, size_t *probes, size_t *cuts) {
   unsigned char goal_depth = GLOBAL_SOLVER.goal.num_sets - 1;
+  unsigned int cutoff_depth = limit + goal_depth;
+  unsigned char depth = 0;
+
+  if (GLOBAL_PREFILTER && (
+    global_stage(&depth, get_nibble(&GLOBAL_SOLVER.edge_orientation, locdir_edge_orientation_index(ldc)), EDGE_ORIENTATION_STAGE, cutoff_depth, probes, cuts) ||
+    global_stage(&depth, get_nibble(&GLOBAL_SOLVER.corner_orientation, locdir_corner_orientation_index(ldc)), CORNER_ORIENTATION_STAGE, cutoff_depth, probes, cuts) ||
+    global_stage(&depth, get_nibble(&GLOBAL_SOLVER.corner_permutation, locdir_corner_permutation_index(ldc)), CORNER_PERMUTATION_STAGE, cutoff_depth, probes, cuts)
+  )) {
+    return depth - goal_depth;
+  }
+  if (
+    global_stage(&depth, get_nibble(&GLOBAL_SOLVER.corners, locdir_corner_index(ldc)), CORNERS_STAGE, cutoff_depth, probes, cuts) ||
+    global_stage(&depth, get_nibble(&GLOBAL_SOLVER.first, locdir_first_7_edge_index(ldc)), FIRST_EDGES_STAGE, cutoff_depth, probes, cuts) ||
+    global_stage(&depth, get_nibble(&GLOBAL_SOLVER.last, locdir_last_7_edge_index(ldc)), LAST_EDGES_STAGE, cutoff_depth, probes, cuts)
+  ) {
+    return depth - goal_depth;
+  }
 
   if (depth < goal_depth) {
     return 0;
@@ -30,9 +123,16 @@ unsigned char global_estimator(LocDirCube *ldc) {
   return depth - goal_depth;
 }
 
+unsigned char global_estimator(LocDirCube *ldc) {
+  // The counts of a single estimate are thrown away
+  size_t probes[NUM_GLOBAL_STAGES] = {0};
+  size_t cuts[NUM_GLOBAL_STAGES] = {0};
+  return global_cascade(ldc, UNKNOWN, probes, cuts);
+}
+
 unsigned char global_edge_estimator(LocDirCube *ldc) {
-  unsigned char depth = get_nibble(&GLOBAL_SOLVER.first, (*GLOBAL_SOLVER.first.index_func)(ldc));
-  unsigned char last_depth = get_nibble(&GLOBAL_SOLVER.last, (*GLOBAL_SOLVER.last.index_func)(ldc));
+  unsigned char depth = get_nibble(&GLOBAL_SOLVER.first, locdir_first_7_edge_index(ldc));
+  unsigned char last_depth = get_nibble(&GLOBAL_SOLVER.last, locdir_last_7_edge_index(ldc));
 
   if (last_depth > depth) {
     depth = last_depth;
@@ -46,19 +146,104 @@ unsigned char global_edge_estimator(LocDirCube *ldc) {
   return depth - goal_depth;
 }
 
+// Maximum of the estimates of the conjugates of a position
+unsigned char global_conjugated_estimator(LocDirCube *ldc, unsigned char limit, size_t *probes, size_t *cuts) {
+  unsigned char estimate = global_cascade(ldc, limit, probes, cuts);
+  for (size_t i = 1; i < GLOBAL_SOLVER.num_conjugations && estimate <= limit; ++i) {
+    LocDirCube conjugate;
+    locdir_conjugate(&conjugate, ldc, i);
+    unsigned char conjugate_estimate = global_cascade(&conjugate, limit, probes, cuts);
+    if (conjugate_estimate > estimate) {
+      estimate = conjugate_estimate;
+    }
+  }
+  return estimate;
+}
+
+// Estimator used by the specialized kernels. Also probes the inverse position if the search tracks it.
+unsigned char global_ida_estimate(IDAstar *ida, unsigned char limit) {
+  ida->num_nodes++;
+  unsigned char estimate = global_conjugated_estimator(&ida->state, limit, ida->stage_probes, ida->stage_cuts);
+  if (ida->track_inverse && estimate <= limit) {
+    unsigned char inverse_estimate = global_conjugated_estimator(&ida->inverse, limit, ida->stage_probes, ida->stage_cuts);
+    if (inverse_estimate > estimate) {
+      estimate = inverse_estimate;
+    }
+  }
+  if (GLOBAL_EXACT_GOAL && estimate == 0) {
+    ida->stage_probes[GOAL_SPHERE_STAGE]++;
+    if (goalsphere_layer_with(&GLOBAL_SOLVER.goal, &ida->state, GLOBAL_GOAL_HASH) == UNKNOWN) {
+      if (limit == 0) {
+        ida->stage_cuts[GOAL_SPHERE_STAGE]++;
+      }
+      return 1;
+    }
+  }
+  return estimate;
+}
+
+void fprint_global_stage_stats(FILE *file, IDAstar *ida) {
+  for (size_t i = 0; i < NUM_GLOBAL_STAGES; ++i) {
+    fprintf(file, "%s: %zu probes, %zu cuts\n", GLOBAL_STAGE_NAMES[i], ida->stage_probes[i], ida->stage_cuts[i]);
+  }
+}
+
 bool global_is_solved(LocDirCube *ldc) {
-  return goalsphere_shell(&GLOBAL_SOLVER.goal, ldc);
+  if (GLOBAL_EXACT_GOAL) {
+    return goalsphere_inside_with(&GLOBAL_SOLVER.goal, ldc, GLOBAL_GOAL_HASH);
+  }
+  return goalsphere_shell_with(&GLOBAL_SOLVER.goal, ldc, GLOBAL_GOAL_HASH);
+}
+
+// The edge search works on edges-only cubes so it has no inverse lookups
+unsigned char global_edge_ida_estimate(IDAstar *ida, unsigned char limit) {
+  ida->num_nodes++;
+  unsigned char estimate = global_edge_estimator(&ida->state);
+  if (GLOBAL_EXACT_GOAL && estimate == 0 && goalsphere_layer_with(&GLOBAL_SOLVER.edge_goal, &ida->state, locdir_edge_index) == UNKNOWN) {
+    return 1;
+  }
+  return estimate;
 }
 
 bool global_edge_is_solved(LocDirCube *ldc) {
-  return goalsphere_shell(&GLOBAL_SOLVER.edge_goal, ldc);
+  if (GLOBAL_EXACT_GOAL) {
+    return goalsphere_inside_with(&GLOBAL_SOLVER.edge_goal, ldc, locdir_edge_index);
+  }
+  return goalsphere_shell_with(&GLOBAL_SOLVER.edge_goal, ldc, locdir_edge_index);
 }
 
+// IDA* kernels specialized for the global solver
+#define IDA_KERNEL(name) global_##name
+#define IDA_KERNEL_ESTIMATOR(ida, limit) global_ida_estimate(ida, limit)
+#define IDA_KERNEL_IS_SOLVED(ida, ldc) global_is_solved(ldc)
+#define IDA_KERNEL_HASH(ida, ldc) locdir_centerless_hash(ldc)
+#include "ida_star_kernel.c"
+
+#define IDA_KERNEL(name) global_edge_##name
+#define IDA_KERNEL_ESTIMATOR(ida, limit) global_edge_ida_estimate(ida, limit)
+#define IDA_KERNEL_IS_SOLVED(ida, ldc) global_edge_is_solved(ldc)
+#include "ida_star_kernel.c"
+
 void prepare_global_solver() {
   FILE *fptr;
   size_t num_read;
   size_t tablebase_size;
 
+  if (MAX_ESTIMATOR_STAGES < NUM_GLOBAL_STAGES) {
+    fprintf(stderr, "Too many estimator stages.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(stderr, "Generating small pre-filter tablebases.\n");
+  LocDirCube solved;
+  locdir_reset(&solved);
+  GLOBAL_SOLVER.edge_orientation = init_nibblebase(LOCDIR_EDGE_ORIENTATION_INDEX_SPACE, &locdir_edge_orientation_index);
+  populate_nibblebase(&GLOBAL_SOLVER.edge_orientation, &solved);
+  GLOBAL_SOLVER.corner_orientation = init_nibblebase(LOCDIR_CORNER_ORIENTATION_INDEX_SPACE, &locdir_corner_orientation_index);
+  populate_nibblebase(&GLOBAL_SOLVER.corner_orientation, &solved);
+  GLOBAL_SOLVER.corner_permutation = init_nibblebase(LOCDIR_CORNER_PERMUTATION_INDEX_SPACE, &locdir_corner_permutation_index);
+  populate_nibblebase(&GLOBAL_SOLVER.corner_permutation, &solved);
+
   fprintf(stderr, "Loading tablebase for first 7 edges.\n");
   GLOBAL_SOLVER.first = init_nibblebase(LOCDIR_FIRST_7_EDGE_INDEX_SPACE, &locdir_first_7_edge_index);
   #ifdef SCISSORS_ENABLED
@@ -116,45 +301,86 @@ void prepare_global_solver() {
   }
   fclose(fptr);
 
-  fprintf(stderr, "Loading database for the last 6 moves.\n");
-  GLOBAL_SOLVER.goal.hash_func = locdir_centerless_hash;
-  GLOBAL_SOLVER.goal.num_sets = 6 + 1;
-  GLOBAL_SOLVER.goal.sets = malloc(GLOBAL_SOLVER.goal.num_sets * sizeof(size_t*));
-  GLOBAL_SOLVER.goal.set_sizes = malloc(GLOBAL_SOLVER.goal.num_sets * sizeof(size_t));
-  GLOBAL_SOLVER.goal.set_sizes[0] = 1;
-  #ifdef SCISSORS_ENABLED
-  GLOBAL_SOLVER.goal.set_sizes[1] = 45;
-  GLOBAL_SOLVER.goal.set_sizes[2] = 1347;
-  GLOBAL_SOLVER.goal.set_sizes[3] = 39631;
-  GLOBAL_SOLVER.goal.set_sizes[4] = 1152290;
-  GLOBAL_SOLVER.goal.set_sizes[5] = 32717804;
-  GLOBAL_SOLVER.goal.set_sizes[6] = 917301225;
-  fptr = fopen("./tables/centerless_sphere_scissors.bin", "rb");
-  #else
-  GLOBAL_SOLVER.goal.set_sizes[1] = 27;
-  GLOBAL_SOLVER.goal.set_sizes[2] = 501;
-  GLOBAL_SOLVER.goal.set_sizes[3] = 9175;
-  GLOBAL_SOLVER.goal.set_sizes[4] = 164900;
-  GLOBAL_SOLVER.goal.set_sizes[5] = 2912447;
-  GLOBAL_SOLVER.goal.set_sizes[6] = 50839041;
-  fptr = fopen("./tables/centerless_sphere.bin", "rb");
-  #endif
-  if (fptr == NULL) {
-    fprintf(stderr, "Failed to open file.\n");
-    exit(EXIT_FAILURE);
-  }
-  for (size_t i = 0; i < GLOBAL_SOLVER.goal.num_sets; ++i) {
-    GLOBAL_SOLVER.goal.sets[i] = malloc(GLOBAL_SOLVER.goal.set_sizes[i] * sizeof(size_t));
-    size_t num_read = fread(GLOBAL_SOLVER.goal.sets[i], sizeof(size_t), GLOBAL_SOLVER.goal.set_sizes[i], fptr);
-    if (num_read != GLOBAL_SOLVER.goal.set_sizes[i]) {
-      fprintf(stderr, "Failed to load data. Only %zu of %zu read.\n", num_read, GLOBAL_SOLVER.goal.set_sizes[i]);
+  if (GLOBAL_SYMMETRIC_GOAL) {
+    fprintf(stderr, "Loading symmetry reduced database for the last moves.\n");
+    #ifdef SCISSORS_ENABLED
+    fptr = fopen("./tables/centerless_symmetric_sphere_scissors.bin", "rb");
+    #else
+    fptr = fopen("./tables/centerless_symmetric_sphere.bin", "rb");
+    #endif
+    if (fptr == NULL) {
+      fprintf(stderr, "Failed to open file.\n");
+      exit(EXIT_FAILURE);
+    }
+    GLOBAL_SOLVER.goal = fread_goalsphere(fptr, locdir_symmetric_inverse_hash, locdir_symmetric_inverse_tag);
+    fclose(fptr);
+  } else {
+    fprintf(stderr, "Loading database for the last 6 moves.\n");
+    GLOBAL_SOLVER.goal.hash_func = locdir_centerless_hash;
+    GLOBAL_SOLVER.goal.tag_func = locdir_centerless_tag;
+    GLOBAL_SOLVER.goal.num_sets = 6 + 1;
+    GLOBAL_SOLVER.goal.sets = malloc(GLOBAL_SOLVER.goal.num_sets * sizeof(size_t*));
+    GLOBAL_SOLVER.goal.tags = malloc(GLOBAL_SOLVER.goal.num_sets * sizeof(unsigned char*));
+    GLOBAL_SOLVER.goal.set_sizes = malloc(GLOBAL_SOLVER.goal.num_sets * sizeof(size_t));
+    GLOBAL_SOLVER.goal.set_sizes[0] = 1;
+    #ifdef SCISSORS_ENABLED
+    GLOBAL_SOLVER.goal.set_sizes[1] = 45;
+    GLOBAL_SOLVER.goal.set_sizes[2] = 1347;
+    GLOBAL_SOLVER.goal.set_sizes[3] = 39631;
+    GLOBAL_SOLVER.goal.set_sizes[4] = 1152290;
+    GLOBAL_SOLVER.goal.set_sizes[5] = 32717804;
+    GLOBAL_SOLVER.goal.set_sizes[6] = 917301225;
+    fptr = fopen("./tables/centerless_sphere_scissors.bin", "rb");
+    #else
+    GLOBAL_SOLVER.goal.set_sizes[1] = 27;
+    GLOBAL_SOLVER.goal.set_sizes[2] = 501;
+    GLOBAL_SOLVER.goal.set_sizes[3] = 9175;
+    GLOBAL_SOLVER.goal.set_sizes[4] = 164900;
+    GLOBAL_SOLVER.goal.set_sizes[5] = 2912447;
+    GLOBAL_SOLVER.goal.set_sizes[6] = 50839041;
+    fptr = fopen("./tables/centerless_sphere.bin", "rb");
+    #endif
+    if (fptr == NULL) {
+      fprintf(stderr, "Failed to open file.\n");
+      exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < GLOBAL_SOLVER.goal.num_sets; ++i) {
+      GLOBAL_SOLVER.goal.sets[i] = malloc(GLOBAL_SOLVER.goal.set_sizes[i] * sizeof(size_t));
+      size_t num_read = fread(GLOBAL_SOLVER.goal.sets[i], sizeof(size_t), GLOBAL_SOLVER.goal.set_sizes[i], fptr);
+      if (num_read != GLOBAL_SOLVER.goal.set_sizes[i]) {
+        fprintf(stderr, "Failed to load data. Only %zu of %zu read.\n", num_read, GLOBAL_SOLVER.goal.set_sizes[i]);
+        exit(EXIT_FAILURE);
+      }
+    }
+    fclose(fptr);
+
+    #ifdef SCISSORS_ENABLED
+    fptr = fopen("./tables/centerless_sphere_tags_scissors.bin", "rb");
+    #else
+    fptr = fopen("./tables/centerless_sphere_tags.bin", "rb");
+    #endif
+    if (fptr == NULL) {
+      fprintf(stderr, "Failed to open file.\n");
       exit(EXIT_FAILURE);
     }
+    for (size_t i = 0; i < GLOBAL_SOLVER.goal.num_sets; ++i) {
+      GLOBAL_SOLVER.goal.tags[i] = malloc(GLOBAL_SOLVER.goal.set_sizes[i] * sizeof(unsigned char));
+      size_t num_read = fread(GLOBAL_SOLVER.goal.tags[i], sizeof(unsigned char), GLOBAL_SOLVER.goal.set_sizes[i], fptr);
+      if (num_read != GLOBAL_SOLVER.goal.set_sizes[i]) {
+        fprintf(stderr, "Failed to load data. Only %zu of %zu read.\n", num_read, GLOBAL_SOLVER.goal.set_sizes[i]);
+        exit(EXIT_FAILURE);
+      }
+    }
+    fclose(fptr);
+
+    fprintf(stderr, "Building filters for the database.\n");
+    goalsphere_build_filters(&GLOBAL_SOLVER.goal);
   }
-  fclose(fptr);
 
   fprintf(stderr, "Loading database for the last 6 moves of an edges-only cube.\n");
   GLOBAL_SOLVER.edge_goal.hash_func = locdir_edge_index;
+  GLOBAL_SOLVER.edge_goal.tag_func = NULL;
+  GLOBAL_SOLVER.edge_goal.tags = NULL;
   GLOBAL_SOLVER.edge_goal.num_sets = 6 + 1;
   GLOBAL_SOLVER.edge_goal.sets = malloc(GLOBAL_SOLVER.edge_goal.num_sets * sizeof(size_t*));
   GLOBAL_SOLVER.edge_goal.set_sizes = malloc(GLOBAL_SOLVER.edge_goal.num_sets * sizeof(size_t));
@@ -190,22 +416,42 @@ void prepare_global_solver() {
   }
   fclose(fptr);
 
-  GLOBAL_SOLVER.ida.is_solved = global_is_solved;
-  GLOBAL_SOLVER.ida.estimator = global_estimator;
+  fprintf(stderr, "Building filters for the database.\n");
+  goalsphere_build_filters(&GLOBAL_SOLVER.edge_goal);
+
+  GLOBAL_SOLVER.ida = init_ida_star(global_is_solved, global_estimator);
+  GLOBAL_SOLVER.ida.move_ordering = GLOBAL_MOVE_ORDERING;
+  GLOBAL_SOLVER.ida.track_inverse = GLOBAL_INVERSE_LOOKUPS;
+  GLOBAL_SOLVER.num_conjugations = GLOBAL_NUM_CONJUGATIONS;
+  if (GLOBAL_SOLVER.num_conjugations < 1 || GLOBAL_SOLVER.num_conjugations > NUM_ORIENTATIONS) {
+    fprintf(stderr, "The number of conjugations must be between 1 and %d.\n", NUM_ORIENTATIONS);
+    exit(EXIT_FAILURE);
+  }
+  prepare_locdir_orientations();
+  if (GLOBAL_TRANSPOSITION_TABLE_BYTES) {
+    GLOBAL_SOLVER.table = init_transposition_table(GLOBAL_TRANSPOSITION_TABLE_BYTES, locdir_centerless_hash);
+    GLOBAL_SOLVER.ida.table = &GLOBAL_SOLVER.table;
+  }
+
+  GLOBAL_SOLVER.edge_ida = init_ida_star(global_edge_is_solved, global_edge_estimator);
+  GLOBAL_SOLVER.edge_ida.move_ordering = GLOBAL_MOVE_ORDERING;
 
-  GLOBAL_SOLVER.edge_ida.is_solved = global_edge_is_solved;
-  GLOBAL_SOLVER.edge_ida.estimator = global_edge_estimator;
+  GLOBAL_SOLVER.cache = init_solution_cache(GLOBAL_SOLUTION_CACHE_ENTRIES);
+  if (GLOBAL_SOLUTION_CACHE_ENTRIES && load_solution_cache(&GLOBAL_SOLVER.cache, GLOBAL_SOLUTION_CACHE_PATH)) {
+    fprintf(stderr, "Loaded %zu cached solutions.\n", GLOBAL_SOLVER.cache.num_entries);
+  }
 
   #ifdef _OPENMP
   fprintf(stderr, "Parallel search enabled.\n");
   #endif
 }
 
-unsigned char global_lower_bound(LocDirCube *ldc) {
+unsigned char global_lower_bound_with(IDAstar *edge_ida, LocDirCube *ldc) {
   unsigned char lower_bound = goalsphere_depth(&GLOBAL_SOLVER.edge_goal, ldc, 0);
   if (lower_bound == UNKNOWN) {
-    ida_star_solve(&GLOBAL_SOLVER.edge_ida, ldc, 0);
-    lower_bound = GLOBAL_SOLVER.edge_ida.path_length - 1 + GLOBAL_SOLVER.edge_goal.num_sets - 1;
+    // A search that ran out of budget has still proven its last bound
+    bool found = global_edge_ida_star_solve(edge_ida, ldc, 0);
+    lower_bound = (found ? edge_ida->num_moves : edge_ida->bound) + GLOBAL_SOLVER.edge_goal.num_sets - 1;
   }
 
   unsigned char goal_depth = GLOBAL_SOLVER.goal.num_sets - 1;
@@ -215,42 +461,178 @@ unsigned char global_lower_bound(LocDirCube *ldc) {
   return lower_bound - goal_depth;
 }
 
-sequence global_solve(LocDirCube *ldc) {
-  unsigned char lower_bound = global_lower_bound(ldc);
+unsigned char global_lower_bound(LocDirCube *ldc) {
+  return global_lower_bound_with(&GLOBAL_SOLVER.edge_ida, ldc);
+}
+
+/*
+Solve using the given search states. Returns INVALID if the search was cancelled. The tables are only read so several threads may solve at once
+as long as each one brings its own copies of GLOBAL_SOLVER.ida and GLOBAL_SOLVER.edge_ida.
+*/
+sequence global_solve_with(IDAstar *ida, IDAstar *edge_ida, LocDirCube *ldc, bool parallel) {
+  // The cache is keyed by symmetries that keep the centers in the standard position
+  bool cacheable = GLOBAL_SOLUTION_CACHE_ENTRIES && locdir_orientation(ldc) == 0;
+  if (cacheable) {
+    bool hit;
+    sequence cached;
+    #pragma omp critical (global_solution_cache)
+    hit = solution_cache_get(&GLOBAL_SOLVER.cache, ldc, &cached);
+    if (hit) {
+      return cached;
+    }
+  }
+
+  if (GLOBAL_JSON_STATS) {
+    ida_star_clear_stats(ida);
+    ida_star_clear_stats(edge_ida);
+  }
+
+  unsigned char lower_bound = global_lower_bound_with(edge_ida, ldc);
 
   sequence first_steps = I;
   unsigned char  goal_depth = goalsphere_depth(&GLOBAL_SOLVER.goal, ldc, 0);
   if (goal_depth == UNKNOWN) {
-    #ifdef _OPENMP
-    ida_star_solve_parallel(&GLOBAL_SOLVER.ida, ldc, lower_bound);
-    #else
-    ida_star_solve(&GLOBAL_SOLVER.ida, ldc, lower_bound);
-    #endif
-    first_steps = ida_to_sequence(&GLOBAL_SOLVER.ida);
+    bool found;
+    if (parallel) {
+      found = global_ida_star_solve_parallel(ida, ldc, lower_bound);
+    } else {
+      found = global_ida_star_solve(ida, ldc, lower_bound);
+    }
+    if (GLOBAL_JSON_STATS) {
+      SearchStats edge_stats = ida_star_stats(edge_ida);
+      SearchStats stats = ida_star_stats(ida);
+      #pragma omp critical (global_json_stats)
+      {
+        fprint_search_stats_json(stderr, &edge_stats, "edges", NULL, 0);
+        fprint_search_stats_json(stderr, &stats, "global", GLOBAL_STAGE_NAMES, NUM_GLOBAL_STAGES);
+      }
+    }
+    if (!found) {
+      return INVALID;
+    }
+    first_steps = ida_to_sequence(ida);
   }
   LocDirCube clone = *ldc;
   locdir_apply_sequence(&clone, first_steps);
   sequence final_steps = goalsphere_solve(&GLOBAL_SOLVER.goal, &clone, 0, &is_better);
-  return concat(first_steps, final_steps);
+  sequence solution = concat(first_steps, final_steps);
+  if (cacheable && solution != INVALID) {
+    #pragma omp critical (global_solution_cache)
+    solution_cache_put(&GLOBAL_SOLVER.cache, ldc, solution);
+  }
+  return solution;
 }
 
-collection global_solve_all_stable(LocDirCube *ldc) {
+sequence global_solve(LocDirCube *ldc) {
+  #ifdef _OPENMP
+  bool parallel = true;
+  #else
+  bool parallel = false;
+  #endif
+  return global_solve_with(&GLOBAL_SOLVER.ida, &GLOBAL_SOLVER.edge_ida, ldc, parallel);
+}
+
+/*
+Anytime version of global_solve_with that gives up once the budget runs out.
+Returns the shorter of the seed and the solution found, or INVALID if neither exists. The seed may be INVALID.
+No solution is shorter than what is written to lower_bound so the result is optimal when they match.
+*/
+sequence global_solve_budgeted(IDAstar *ida, IDAstar *edge_ida, LocDirCube *ldc, sequence seed, SearchBudget *budget, bool parallel, unsigned char *lower_bound) {
+  bool cacheable = GLOBAL_SOLUTION_CACHE_ENTRIES && locdir_orientation(ldc) == 0;
+  if (cacheable) {
+    bool hit;
+    sequence cached;
+    #pragma omp critical (global_solution_cache)
+    hit = solution_cache_get(&GLOBAL_SOLVER.cache, ldc, &cached);
+    if (hit) {
+      *lower_bound = sequence_length(cached);
+      return cached;
+    }
+  }
+
+  unsigned char goal_depth = goalsphere_depth(&GLOBAL_SOLVER.goal, ldc, 0);
+  if (goal_depth != UNKNOWN) {
+    *lower_bound = goal_depth;
+    return goalsphere_solve(&GLOBAL_SOLVER.goal, ldc, 0, &is_better);
+  }
+
+  // Everything outside the goal sphere is at least one move past its last layer
+  unsigned char shell_depth = GLOBAL_SOLVER.goal.num_sets - 1;
+  ida_star_set_budget(edge_ida, budget);
+  unsigned char first_bound = global_lower_bound_with(edge_ida, ldc);
+  ida_star_set_budget(edge_ida, NULL);
+  *lower_bound = first_bound ? first_bound + shell_depth : shell_depth + 1;
+
+  unsigned char seed_length = seed == INVALID ? UNKNOWN : sequence_length(seed);
+  if (seed_length <= *lower_bound || budget->exhausted || search_cancelled()) {
+    return seed;
+  }
+
+  // Only look for solutions shorter than the seed
+  unsigned char max_bound = budget->max_bound;
+  if (seed_length - shell_depth - 1 < budget->max_bound) {
+    budget->max_bound = seed_length - shell_depth - 1;
+  }
+  ida_star_set_budget(ida, budget);
+  bool found;
+  if (parallel) {
+    found = global_ida_star_solve_parallel(ida, ldc, first_bound);
+  } else {
+    found = global_ida_star_solve(ida, ldc, first_bound);
+  }
+  ida_star_set_budget(ida, NULL);
+  budget->max_bound = max_bound;
+  if (ida->bound + shell_depth > *lower_bound) {
+    *lower_bound = ida->bound + shell_depth;
+  }
+  if (!found) {
+    return seed;
+  }
+
+  sequence first_steps = ida_to_sequence(ida);
+  LocDirCube clone = *ldc;
+  locdir_apply_sequence(&clone, first_steps);
+  sequence solution = concat(first_steps, goalsphere_solve(&GLOBAL_SOLVER.goal, &clone, 0, &is_better));
+  *lower_bound = sequence_length(solution);
+  if (cacheable) {
+    #pragma omp critical (global_solution_cache)
+    solution_cache_put(&GLOBAL_SOLVER.cache, ldc, solution);
+  }
+  return solution;
+}
+
+// Returns NULL if the search was cancelled
+collection global_solve_all_stable_with(IDAstar *ida, IDAstar *edge_ida, LocDirCube *ldc) {
+  // The initial estimates of the searches below do not check the token
+  if (search_cancelled()) {
+    return NULL;
+  }
   unsigned char goal_depth = goalsphere_depth(&GLOBAL_SOLVER.goal, ldc, 0);
   if (goal_depth != UNKNOWN) {
     return goalsphere_solve_all_stable(&GLOBAL_SOLVER.goal, ldc, 0);
   }
 
-  unsigned char lower_bound = global_lower_bound(ldc);
+  unsigned char lower_bound = global_lower_bound_with(edge_ida, ldc);
 
   collection result = malloc(sizeof(sequence));
   result[0] = SENTINEL;
 
-  collection initials = ida_star_solve_all_stable(&GLOBAL_SOLVER.ida, ldc, lower_bound);
+  collection initials = global_ida_star_solve_all_stable(ida, ldc, lower_bound);
+  if (initials == NULL) {
+    free(result);
+    return NULL;
+  }
   collection it = initials;
   while (*it != SENTINEL) {
     LocDirCube clone = *ldc;
     locdir_apply_stable_sequence(&clone, *it);
     collection finals = goalsphere_solve_all_stable(&GLOBAL_SOLVER.goal, &clone, 0);
+    if (search_cancelled()) {
+      free(finals);
+      free(initials);
+      free(result);
+      return NULL;
+    }
     if (finals == NULL) {
       fprintf(stderr, "IDA* landed outside the goalsphere.\n");
       exit(EXIT_FAILURE);
@@ -270,11 +652,20 @@ collection global_solve_all_stable(LocDirCube *ldc) {
   return result;
 }
 
-collection global_solve_all(LocDirCube *ldc) {
+collection global_solve_all_stable(LocDirCube *ldc) {
+  return global_solve_all_stable_with(&GLOBAL_SOLVER.ida, &GLOBAL_SOLVER.edge_ida, ldc);
+}
+
+// Returns NULL if the search was cancelled
+collection global_solve_all_with(IDAstar *ida, IDAstar *edge_ida, LocDirCube *ldc) {
   collection result = malloc(sizeof(sequence));
   result[0] = SENTINEL;
 
-  collection stable = global_solve_all_stable(ldc);
+  collection stable = global_solve_all_stable_with(ida, edge_ida, ldc);
+  if (stable == NULL) {
+    free(result);
+    return NULL;
+  }
   collection it = stable;
   while (*it != SENTINEL) {
     result = extend_collection(result, expand_stable_sequence(*it));
@@ -285,10 +676,24 @@ collection global_solve_all(LocDirCube *ldc) {
   return result;
 }
 
+collection global_solve_all(LocDirCube *ldc) {
+  return global_solve_all_with(&GLOBAL_SOLVER.ida, &GLOBAL_SOLVER.edge_ida, ldc);
+}
+
 void free_global_solver() {
+  free_nibblebase(&GLOBAL_SOLVER.edge_orientation);
+  free_nibblebase(&GLOBAL_SOLVER.corner_orientation);
+  free_nibblebase(&GLOBAL_SOLVER.corner_permutation);
   free_nibblebase(&GLOBAL_SOLVER.first);
   free_nibblebase(&GLOBAL_SOLVER.last);
   free_nibblebase(&GLOBAL_SOLVER.corners);
   free_goalsphere(&GLOBAL_SOLVER.goal);
   free_goalsphere(&GLOBAL_SOLVER.edge_goal);
+  if (GLOBAL_SOLUTION_CACHE_ENTRIES) {
+    fprint_solution_cache_stats(stderr, &GLOBAL_SOLVER.cache);
+    if (!save_solution_cache(&GLOBAL_SOLVER.cache, GLOBAL_SOLUTION_CACHE_PATH)) {
+      fprintf(stderr, "Failed to save the solution cache.\n");
+    }
+  }
+  free_solution_cache(&GLOBAL_SOLVER.cache);
 }
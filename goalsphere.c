@@ -1,8 +1,34 @@
+#include "stdint.h"
+
+// Memory spent per key on the approximate membership filters
+#define GOALSPHERE_FILTER_BITS_PER_KEY (10)
+
+// Layers small enough to stay in cache are searched directly
+#define GOALSPHERE_FILTER_MIN_KEYS (1 << 16)
+
+// Number of positions that goalsphere_depths expands and looks up in one batch
+#define GOALSPHERE_DEPTHS_BATCH (1 << 16)
+
+// Blocked Bloom filter. Each key sets a few bits within a single cache line.
+typedef struct {
+  size_t *blocks;
+  size_t num_blocks;
+} BloomFilter;
+
+#define BLOOM_BLOCK_WORDS (8)
+#define BLOOM_NUM_PROBES (6)
+
+// The hash together with the optional tag must identify a position uniquely.
+// Tags hold the bits of the key that do not fit in the hash. They are only computed when the hash is found.
+// Filters are optional and rule out most misses before the binary search.
 typedef struct {
   size_t **sets;
+  unsigned char **tags;
+  BloomFilter *filters;
   size_t *set_sizes;
   size_t num_sets;
   size_t (*hash_func)(LocDirCube*);
+  unsigned char (*tag_func)(LocDirCube*);
 } GoalSphere;
 
 int cmp_size_t(const void *a, const void *b) {
@@ -17,6 +43,111 @@ int cmp_size_t(const void *a, const void *b) {
   return 0;
 }
 
+static inline void swap_tagged_hashes(size_t *hashes, unsigned char *tags, size_t i, size_t j) {
+  size_t hash = hashes[i];
+  hashes[i] = hashes[j];
+  hashes[j] = hash;
+  unsigned char tag = tags[i];
+  tags[i] = tags[j];
+  tags[j] = tag;
+}
+
+static inline int cmp_tagged_hash(size_t hash, unsigned char tag, size_t pivot_hash, unsigned char pivot_tag) {
+  if (hash != pivot_hash) {
+    return hash < pivot_hash ? -1 : 1;
+  }
+  return (int)tag - (int)pivot_tag;
+}
+
+// Sorts hashes together with their tags that are kept in a parallel array.
+// Quicksort that partitions three ways because the candidates of a layer repeat a lot.
+void sort_tagged_hashes(size_t *hashes, unsigned char *tags, size_t size) {
+  while (size > 1) {
+    size_t pivot_hash = hashes[size / 2];
+    unsigned char pivot_tag = tags[size / 2];
+    size_t num_less = 0;
+    size_t num_greater = 0;
+    size_t i = 0;
+    while (i < size - num_greater) {
+      int cmp = cmp_tagged_hash(hashes[i], tags[i], pivot_hash, pivot_tag);
+      if (cmp < 0) {
+        swap_tagged_hashes(hashes, tags, i++, num_less++);
+      } else if (cmp > 0) {
+        swap_tagged_hashes(hashes, tags, i, size - ++num_greater);
+      } else {
+        i++;
+      }
+    }
+    // Recursing into the smaller side keeps the stack logarithmic
+    if (num_less < num_greater) {
+      sort_tagged_hashes(hashes, tags, num_less);
+      hashes += size - num_greater;
+      tags += size - num_greater;
+      size = num_greater;
+    } else {
+      sort_tagged_hashes(hashes + size - num_greater, tags + size - num_greater, num_greater);
+      size = num_less;
+    }
+  }
+}
+
+// The sphere hashes are ranks, so they are mixed before picking the block and the bits
+static inline size_t bloom_mix(size_t hash) {
+  hash ^= hash >> 31;
+  hash *= 0x7fb5d329728ea185ULL;
+  hash ^= hash >> 27;
+  hash *= 0x81dadef4bc2dd44dULL;
+  return hash ^ (hash >> 33);
+}
+
+BloomFilter init_bloom_filter(size_t num_keys, size_t bits_per_key) {
+  BloomFilter filter;
+  filter.num_blocks = (num_keys * bits_per_key + 64 * BLOOM_BLOCK_WORDS - 1) / (64 * BLOOM_BLOCK_WORDS);
+  filter.blocks = aligned_alloc(64, filter.num_blocks * BLOOM_BLOCK_WORDS * sizeof(size_t));
+  if (filter.blocks == NULL) {
+    fprintf(stderr, "Failed to allocate the filter.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < filter.num_blocks * BLOOM_BLOCK_WORDS; ++i) {
+    filter.blocks[i] = 0;
+  }
+  return filter;
+}
+
+void free_bloom_filter(BloomFilter *filter) {
+  free(filter->blocks);
+  filter->blocks = NULL;
+  filter->num_blocks = 0;
+}
+
+// The block comes from the high bits of the mixed hash and the bit positions from a second round of mixing
+static inline size_t *bloom_block(BloomFilter *filter, size_t hash, size_t *bits) {
+  size_t mixed = bloom_mix(hash);
+  *bits = bloom_mix(mixed + 0x9e3779b97f4a7c15ULL);
+  return filter->blocks + (size_t)(((unsigned __int128) mixed * filter->num_blocks) >> 64) * BLOOM_BLOCK_WORDS;
+}
+
+void bloom_add(BloomFilter *filter, size_t hash) {
+  size_t bits;
+  size_t *block = bloom_block(filter, hash, &bits);
+  for (int i = 0; i < BLOOM_NUM_PROBES; ++i) {
+    block[(bits >> 6) & (BLOOM_BLOCK_WORDS - 1)] |= 1ULL << (bits & 63);
+    bits >>= 9;
+  }
+}
+
+static inline bool bloom_may_contain(BloomFilter *filter, size_t hash) {
+  size_t bits;
+  size_t *block = bloom_block(filter, hash, &bits);
+  for (int i = 0; i < BLOOM_NUM_PROBES; ++i) {
+    if (!(block[(bits >> 6) & (BLOOM_BLOCK_WORDS - 1)] & (1ULL << (bits & 63)))) {
+      return false;
+    }
+    bits >>= 9;
+  }
+  return true;
+}
+
 bool set_has(size_t *set, size_t size, size_t hash) {
   size_t halfway;
   size_t halfway_value;
@@ -44,133 +175,363 @@ bool set_has(size_t *set, size_t size, size_t hash) {
 
 const size_t OUTSIDE = ~0ULL;
 
-size_t set_index(size_t *set, size_t size, size_t hash) {
-  if (size <= 0) {
+// Index of the first occurrence of the hash or OUTSIDE
+size_t set_find(size_t *set, size_t size, size_t hash) {
+  size_t end = size;
+  size_t low = 0;
+  while (size > 0) {
+    size_t halfway = size >> 1;
+    if (set[low + halfway] < hash) {
+      low += halfway + 1;
+      size -= halfway + 1;
+    } else {
+      size = halfway;
+    }
+  }
+  return (low < end && set[low] == hash) ? low : OUTSIDE;
+}
+
+// Index of the key in a layer or OUTSIDE
+size_t goalsphere_index(GoalSphere *sphere, size_t depth, size_t hash, unsigned char tag) {
+  if (sphere->filters && sphere->filters[depth].num_blocks && !bloom_may_contain(sphere->filters + depth, hash)) {
     return OUTSIDE;
   }
-  size_t halfway = size / 2;
-  if (set[halfway] == hash) {
-    return halfway;
+  size_t size = sphere->set_sizes[depth];
+  size_t index = set_find(sphere->sets[depth], size, hash);
+  if (index == OUTSIDE || sphere->tags == NULL) {
+    return index;
   }
-  if (hash < set[halfway]) {
-    return set_index(set, halfway, hash);
+  for (; index < size && sphere->sets[depth][index] == hash; ++index) {
+    if (sphere->tags[depth][index] == tag) {
+      return index;
+    }
   }
-  if (size <= halfway) {
-    return size + 1;
+  return OUTSIDE;
+}
+
+// Whether a layer contains the position with the given hash. The tag is only computed on a hit.
+static inline __attribute__((always_inline)) bool goalsphere_layer_has(GoalSphere *sphere, size_t depth, size_t hash, LocDirCube *ldc) {
+  if (sphere->filters && sphere->filters[depth].num_blocks && !bloom_may_contain(sphere->filters + depth, hash)) {
+    return false;
   }
-  size_t right_index = set_index(set + halfway + 1, size - halfway - 1, hash);
-  if (right_index == OUTSIDE) {
-    return OUTSIDE;
+  if (!set_has(sphere->sets[depth], sphere->set_sizes[depth], hash)) {
+    return false;
   }
-  return halfway + 1 + right_index;
+  if (sphere->tags == NULL) {
+    return true;
+  }
+  return goalsphere_index(sphere, depth, hash, (*sphere->tag_func)(ldc)) != OUTSIDE;
 }
 
-unsigned char goalsphere_depth_(GoalSphere *sphere, size_t hash) {
+unsigned char goalsphere_tag(GoalSphere *sphere, LocDirCube *ldc) {
+  if (sphere->tag_func == NULL) {
+    return 0;
+  }
+  return (*sphere->tag_func)(ldc);
+}
+
+unsigned char goalsphere_depth_(GoalSphere *sphere, size_t hash, unsigned char tag) {
   for (unsigned char depth = 0; depth < sphere->num_sets; ++depth) {
-    if (set_has(sphere->sets[depth], sphere->set_sizes[depth], hash)) {
+    if (goalsphere_index(sphere, depth, hash, tag) != OUTSIDE) {
       return depth;
     }
   }
   return UNKNOWN;
 }
 
+// Always inlined so that callers passing a known hash function get a direct (and inlineable) call
+static inline __attribute__((always_inline)) bool goalsphere_shell_with(GoalSphere *sphere, LocDirCube *ldc, size_t (*hash_func)(LocDirCube*)) {
+  return goalsphere_layer_has(sphere, sphere->num_sets - 1, (*hash_func)(ldc), ldc);
+}
+
 bool goalsphere_shell(GoalSphere *sphere, LocDirCube *ldc) {
-  size_t last = sphere->num_sets - 1;
-  if (set_has(sphere->sets[last], sphere->set_sizes[last], (*sphere->hash_func)(ldc))) {
-    // Double check to rule out hash collisions
-    size_t penultimate = sphere->num_sets - 2;
-    for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
-      LocDirCube child = *ldc;
-      locdir_apply_stable(&child, STABLE_MOVES[i]);
-      if (set_has(sphere->sets[penultimate], sphere->set_sizes[penultimate], (*sphere->hash_func)(&child))) {
-        return true;
-      }
+  return goalsphere_shell_with(sphere, ldc, sphere->hash_func);
+}
+
+// Layer containing the position or UNKNOWN if it lies outside. The layers are searched from the outermost (and largest) one inwards.
+static inline __attribute__((always_inline)) unsigned char goalsphere_layer_with(GoalSphere *sphere, LocDirCube *ldc, size_t (*hash_func)(LocDirCube*)) {
+  size_t hash = (*hash_func)(ldc);
+  for (size_t depth = sphere->num_sets; depth-- > 0;) {
+    if (goalsphere_layer_has(sphere, depth, hash, ldc)) {
+      return depth;
     }
-    return false;
   }
-  return false;
+  return UNKNOWN;
 }
 
-unsigned char goalsphere_depth(GoalSphere *sphere, LocDirCube *ldc, unsigned char search_depth) {
-  LocDirCube path[SEQUENCE_MAX_LENGTH];
-  path[0] = *ldc;
-  size_t path_length = 1;
+// Like goalsphere_shell_with, but any layer counts
+static inline __attribute__((always_inline)) bool goalsphere_inside_with(GoalSphere *sphere, LocDirCube *ldc, size_t (*hash_func)(LocDirCube*)) {
+  return goalsphere_layer_with(sphere, ldc, hash_func) != UNKNOWN;
+}
 
-  unsigned char search(unsigned char so_far) {
-    size_t hash = (*sphere->hash_func)(path + path_length - 1);
-    unsigned char depth = goalsphere_depth_(sphere, hash);
-    if (depth != UNKNOWN) {
-      return depth;
+bool goalsphere_inside(GoalSphere *sphere, LocDirCube *ldc) {
+  return goalsphere_inside_with(sphere, ldc, sphere->hash_func);
+}
+
+typedef struct {
+  size_t hash;
+  size_t index;
+  unsigned char tag;
+} SphereQuery;
+
+// Least significant digit first radix sort by hash. Passes where every key has the same digit are skipped.
+void radix_sort_queries(SphereQuery *queries, size_t num_queries) {
+  SphereQuery *buffer = malloc(num_queries * sizeof(SphereQuery));
+  SphereQuery *source = queries;
+  SphereQuery *target = buffer;
+  for (int shift = 0; shift < 64; shift += 8) {
+    size_t counts[256] = {0};
+    for (size_t i = 0; i < num_queries; ++i) {
+      counts[(source[i].hash >> shift) & 255]++;
     }
-    if (so_far >= search_depth) {
-      return UNKNOWN;
+    if (counts[(source[0].hash >> shift) & 255] == num_queries) {
+      continue;
     }
-    unsigned char min = UNKNOWN;
-    for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
-      path[path_length] = path[path_length - 1];
-      locdir_apply_stable(path + path_length, STABLE_MOVES[i]);
-      bool in_path = false;
-      for (size_t j = 0; j < path_length; ++j) {
-        if (locdir_equals(path + j, path + path_length)) {
-          in_path = true;
+    size_t offset = 0;
+    for (size_t i = 0; i < 256; ++i) {
+      size_t count = counts[i];
+      counts[i] = offset;
+      offset += count;
+    }
+    for (size_t i = 0; i < num_queries; ++i) {
+      target[counts[(source[i].hash >> shift) & 255]++] = source[i];
+    }
+    SphereQuery *temp = source;
+    source = target;
+    target = temp;
+  }
+  if (source != queries) {
+    for (size_t i = 0; i < num_queries; ++i) {
+      queries[i] = source[i];
+    }
+  }
+  free(buffer);
+}
+
+// First index at or after start with a hash that is not below the given one. The step doubles until it overshoots
+// so that dense queries walk the set linearly while sparse ones cost a logarithmic search.
+size_t set_gallop(size_t *set, size_t size, size_t start, size_t hash) {
+  size_t step = 1;
+  size_t low = start;
+  size_t high = start;
+  while (high < size && set[high] < hash) {
+    low = high + 1;
+    high += step;
+    step *= 2;
+  }
+  if (high > size) {
+    high = size;
+  }
+  while (low < high) {
+    size_t halfway = low + (high - low) / 2;
+    if (set[halfway] < hash) {
+      low = halfway + 1;
+    } else {
+      high = halfway;
+    }
+  }
+  return low;
+}
+
+// Finds the layer of every query (or UNKNOWN) at the position given by its index.
+// The queries are sorted by hash and every layer is then walked once in the same order instead of being searched at random.
+void goalsphere_query_layers(GoalSphere *sphere, SphereQuery *queries, size_t num_queries, unsigned char *layers) {
+  if (num_queries == 0) {
+    return;
+  }
+  radix_sort_queries(queries, num_queries);
+  for (size_t i = 0; i < num_queries; ++i) {
+    layers[queries[i].index] = UNKNOWN;
+  }
+  for (size_t depth = 0; depth < sphere->num_sets; ++depth) {
+    size_t *set = sphere->sets[depth];
+    size_t size = sphere->set_sizes[depth];
+    size_t position = 0;
+    for (size_t i = 0; i < num_queries && position < size; ++i) {
+      position = set_gallop(set, size, position, queries[i].hash);
+      for (size_t j = position; j < size && set[j] == queries[i].hash; ++j) {
+        if (sphere->tags == NULL || sphere->tags[depth][j] == queries[i].tag) {
+          layers[queries[i].index] = depth;
           break;
         }
       }
-      if (in_path) {
-        continue;
+    }
+  }
+}
+
+SphereQuery goalsphere_query(GoalSphere *sphere, LocDirCube *ldc, size_t index) {
+  SphereQuery query;
+  query.hash = (*sphere->hash_func)(ldc);
+  query.index = index;
+  query.tag = goalsphere_tag(sphere, ldc);
+  return query;
+}
+
+/*
+Distances from the sphere center found by searching up to search_depth moves around each of the positions.
+The children are expanded and answered by a single batch query at most batch_size at a time. The search goes depth first over
+the batches so that it holds at most search_depth batches of children at once instead of everything within search_depth moves.
+Cancellation stops it between batches leaving the depths that were not settled too large.
+Returns the largest number of children that were held at once.
+*/
+size_t goalsphere_depths_batched(GoalSphere *sphere, LocDirCube *ldcs, size_t num_ldcs, unsigned char search_depth, unsigned char *depths, size_t batch_size) {
+  SphereQuery *queries = malloc(num_ldcs * sizeof(SphereQuery));
+  for (size_t i = 0; i < num_ldcs; ++i) {
+    queries[i] = goalsphere_query(sphere, ldcs + i, i);
+  }
+  goalsphere_query_layers(sphere, queries, num_ldcs, depths);
+  free(queries);
+
+  // Positions outside the sphere together with the index of the position they were reached from
+  LocDirCube *frontier = malloc(num_ldcs * sizeof(LocDirCube));
+  size_t *origins = malloc(num_ldcs * sizeof(size_t));
+  size_t frontier_size = 0;
+  for (size_t i = 0; i < num_ldcs; ++i) {
+    if (depths[i] == UNKNOWN) {
+      frontier[frontier_size] = ldcs[i];
+      origins[frontier_size++] = i;
+    }
+  }
+
+  size_t batch_parents = batch_size / NUM_STABLE_MOVES;
+  if (batch_parents == 0) {
+    batch_parents = 1;
+  }
+  size_t num_held = 0;
+  size_t peak_held = 0;
+
+  void expand(LocDirCube *parents, size_t *parent_origins, size_t num_parents, unsigned char level) {
+    // The last level is only queried so its positions are not stored
+    bool last = (level == search_depth);
+    for (size_t start = 0; start < num_parents && !search_cancelled(); start += batch_parents) {
+      size_t end = start + batch_parents < num_parents ? start + batch_parents : num_parents;
+      size_t max_children = (end - start) * NUM_STABLE_MOVES;
+      num_held += max_children;
+      if (num_held > peak_held) {
+        peak_held = num_held;
+      }
+      LocDirCube *children = last ? NULL : malloc(max_children * sizeof(LocDirCube));
+      size_t *child_origins = malloc(max_children * sizeof(size_t));
+      SphereQuery *child_queries = malloc(max_children * sizeof(SphereQuery));
+      size_t num_children = 0;
+      for (size_t i = start; i < end; ++i) {
+        // Earlier batches may have settled the origin since the parent was stored
+        if (depths[parent_origins[i]] <= level) {
+          continue;
+        }
+        for (size_t j = 0; j < NUM_STABLE_MOVES; ++j) {
+          LocDirCube child = parents[i];
+          locdir_apply_stable(&child, STABLE_MOVES[j]);
+          if (!last) {
+            children[num_children] = child;
+          }
+          child_origins[num_children] = parent_origins[i];
+          child_queries[num_children] = goalsphere_query(sphere, &child, num_children);
+          num_children++;
+        }
       }
-      path_length++;
-      unsigned char child_depth = search(so_far + 1);
-      path_length--;
-      if (child_depth < min) {
-        min = child_depth;
+      unsigned char *layers = malloc(max_children * sizeof(unsigned char));
+      goalsphere_query_layers(sphere, child_queries, num_children, layers);
+      free(child_queries);
+
+      for (size_t k = 0; k < num_children; ++k) {
+        size_t origin = child_origins[k];
+        if (layers[k] != UNKNOWN && level + layers[k] < depths[origin]) {
+          depths[origin] = level + layers[k];
+        }
       }
+      // Positions further out cannot improve on a depth that the next level would reach
+      size_t num_outside = 0;
+      for (size_t k = 0; !last && k < num_children; ++k) {
+        if (layers[k] == UNKNOWN && depths[child_origins[k]] > level + 1) {
+          children[num_outside] = children[k];
+          child_origins[num_outside++] = child_origins[k];
+        }
+      }
+      free(layers);
+      if (num_outside > 0) {
+        expand(children, child_origins, num_outside, level + 1);
+      }
+      free(children);
+      free(child_origins);
+      num_held -= max_children;
     }
-    if (min == UNKNOWN) {
-      return UNKNOWN;
-    }
-    return min + 1;
   }
 
-  return search(0);
+  if (search_depth > 0 && frontier_size > 0) {
+    expand(frontier, origins, frontier_size, 1);
+  }
+  free(frontier);
+  free(origins);
+  return peak_held;
+}
+
+void goalsphere_depths(GoalSphere *sphere, LocDirCube *ldcs, size_t num_ldcs, unsigned char search_depth, unsigned char *depths) {
+  goalsphere_depths_batched(sphere, ldcs, num_ldcs, search_depth, depths, GOALSPHERE_DEPTHS_BATCH);
+}
+
+unsigned char goalsphere_depth(GoalSphere *sphere, LocDirCube *ldc, unsigned char search_depth) {
+  if (search_depth == 0) {
+    return goalsphere_layer_with(sphere, ldc, sphere->hash_func);
+  }
+  unsigned char depth;
+  goalsphere_depths(sphere, ldc, 1, search_depth, &depth);
+  return depth;
 }
 
 sequence goalsphere_solve(GoalSphere *sphere, LocDirCube *ldc, unsigned char search_depth, bool (*better)(sequence a, sequence b)) {
   if (sphere->num_sets < 1) {
     return INVALID;
   }
+  prepare_locdir_orientations();
   LocDirCube aligned = *ldc;
   locdir_realign(&aligned);
-  if (sphere->sets[0][0] == sphere->hash_func(&aligned)) {
+  if (goalsphere_layer_has(sphere, 0, sphere->hash_func(&aligned), &aligned)) {
     return I;
   }
+  // The path is tracked in realigned form together with the orientation of the centers
   LocDirCube path[SEQUENCE_MAX_LENGTH];
-  path[0] = *ldc;
+  unsigned char orientations[SEQUENCE_MAX_LENGTH];
+  path[0] = aligned;
+  orientations[0] = locdir_orientation(ldc);
   size_t path_length = 1;
 
   sequence solve(unsigned char search_depth_) {
+    if (search_cancelled()) {
+      return INVALID;
+    }
     unsigned char best_depth = UNKNOWN;
     LocDirCube children[NUM_MOVES - 1];
+    unsigned char child_orientations[NUM_MOVES - 1];
     bool best[NUM_MOVES - 1];
+    bool in_path[NUM_MOVES - 1];
     size_t i = 0;
     for (enum move move = U; move <= MAX_MOVE; ++move) {
+      OrientedMove oriented = LOCDIR_ORIENTED_MOVES[orientations[path_length - 1]][move];
       children[i] = path[path_length - 1];
-      locdir_apply(children + i, move);
-      bool in_path = false;
+      locdir_apply_stable(children + i, oriented.move);
+      child_orientations[i] = oriented.orientation;
+      in_path[i] = false;
       for (size_t j = 0; j < path_length; ++j) {
-        if (locdir_equals(children + i, path + j)) {
-          in_path = true;
+        if (child_orientations[i] == orientations[j] && locdir_equals(children + i, path + j)) {
+          in_path[i] = true;
           break;
         }
       }
-      if (in_path) {
+      i++;
+    }
+    // The children are looked up together
+    unsigned char depths[NUM_MOVES - 1];
+    goalsphere_depths(sphere, children, i, search_depth_, depths);
+
+    i = 0;
+    for (enum move move = U; move <= MAX_MOVE; ++move) {
+      if (in_path[i]) {
         best[i] = false;
         i++;
         continue;
       }
-      aligned = children[i];
-      locdir_realign(&aligned);
-      unsigned char depth = goalsphere_depth(sphere, &aligned, search_depth_);
+      unsigned char depth = depths[i];
       if (depth < best_depth) {
         best_depth = depth;
         for (int idx = 0; idx < i; ++idx) {
@@ -203,6 +564,7 @@ sequence goalsphere_solve(GoalSphere *sphere, LocDirCube *ldc, unsigned char sea
     i = 0;
     for (enum move move = U; move <= MAX_MOVE; ++move) {
       if (best[i]) {
+        orientations[path_length] = child_orientations[i];
         path[path_length++] = children[i];
         sequence candidate = concat(move, solve(search_depth_));
         path_length--;
@@ -215,14 +577,16 @@ sequence goalsphere_solve(GoalSphere *sphere, LocDirCube *ldc, unsigned char sea
     return solution;
   }
 
-  return solve(search_depth);
+  sequence solution = solve(search_depth);
+  return search_cancelled() ? INVALID : solution;
 }
 
+// Returns NULL if there is no solution or if the search was cancelled
 collection goalsphere_solve_all_stable(GoalSphere *sphere, LocDirCube *ldc, unsigned char search_depth) {
   if (sphere->num_sets < 1) {
     return NULL;
   }
-  if (sphere->sets[0][0] == sphere->hash_func(ldc)) {
+  if (goalsphere_layer_has(sphere, 0, sphere->hash_func(ldc), ldc)) {
     collection result = malloc(2 * sizeof(sequence));
     result[0] = I;
     result[1] = SENTINEL;
@@ -233,23 +597,33 @@ collection goalsphere_solve_all_stable(GoalSphere *sphere, LocDirCube *ldc, unsi
   size_t path_length = 1;
 
   collection solve(unsigned char search_depth_) {
+    if (search_cancelled()) {
+      return NULL;
+    }
     unsigned char best_depth = UNKNOWN;
     LocDirCube children[NUM_STABLE_MOVES];
     bool best[NUM_STABLE_MOVES];
+    bool in_path[NUM_STABLE_MOVES];
     for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
       children[i] = path[path_length - 1];
       locdir_apply_stable(children + i, STABLE_MOVES[i]);
-      bool in_path = false;
+      in_path[i] = false;
       for (size_t j = 0; j < path_length; ++j) {
         if (locdir_equals(children + i, path + j)) {
-          in_path = true;
+          in_path[i] = true;
           break;
         }
       }
-      if (in_path) {
+    }
+    // The children are looked up together
+    unsigned char depths[NUM_STABLE_MOVES];
+    goalsphere_depths(sphere, children, NUM_STABLE_MOVES, search_depth_, depths);
+
+    for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+      if (in_path[i]) {
         best[i] = false;
       } else {
-        unsigned char depth = goalsphere_depth(sphere, children + i, search_depth_);
+        unsigned char depth = depths[i];
         if (depth < best_depth) {
           best_depth = depth;
           for (int idx = 0; idx < i; ++idx) {
@@ -298,6 +672,13 @@ collection goalsphere_solve_all_stable(GoalSphere *sphere, LocDirCube *ldc, unsi
       if (best[i]) {
         path[path_length++] = children[i];
         child_results[num_best] = solve(search_depth_);
+        if (search_cancelled()) {
+          for (size_t j = 0; j <= num_best; ++j) {
+            free(child_results[j]);
+          }
+          free(child_results);
+          return NULL;
+        }
 
         // Technically the NULL case shouldn't happen. (best_depth == UNKNOWN) should have triggered above,
         // but maybe this is related to hash collisions.
@@ -343,11 +724,32 @@ collection goalsphere_solve_all_stable(GoalSphere *sphere, LocDirCube *ldc, unsi
 }
 
 
-void update_goalsphere(GoalSphere *sphere, LocDirCube *ldc, size_t depth, size_t max_depth, bool *boundary) {
-  size_t hash = (*sphere->hash_func)(ldc);
+// Builds filters for the layers that are too large to stay in cache
+void goalsphere_build_filter(GoalSphere *sphere, size_t depth) {
+  sphere->filters[depth].blocks = NULL;
+  sphere->filters[depth].num_blocks = 0;
+  if (sphere->set_sizes[depth] < GOALSPHERE_FILTER_MIN_KEYS) {
+    return;
+  }
+  sphere->filters[depth] = init_bloom_filter(sphere->set_sizes[depth], GOALSPHERE_FILTER_BITS_PER_KEY);
+  for (size_t i = 0; i < sphere->set_sizes[depth]; ++i) {
+    bloom_add(sphere->filters + depth, sphere->sets[depth][i]);
+  }
+}
+
+void goalsphere_build_filters(GoalSphere *sphere) {
+  sphere->filters = malloc(sphere->num_sets * sizeof(BloomFilter));
+  for (size_t depth = 0; depth < sphere->num_sets; ++depth) {
+    goalsphere_build_filter(sphere, depth);
+  }
+}
+
+// With premoves the boundary positions are also expanded by moves applied before them.
+// This is needed when the keys identify a position with its inverse, whose children are the premove children of the position.
+void update_goalsphere(GoalSphere *sphere, LocDirCube *ldc, size_t depth, size_t max_depth, bool *boundary, size_t *candidates, unsigned char *candidate_tags, size_t *num_candidates, bool premoves) {
   if (depth == max_depth - 1) {
-    size_t set_size = sphere->set_sizes[sphere->num_sets - 1];
-    size_t boundary_index = set_index(sphere->sets[sphere->num_sets - 1], set_size, hash);
+    size_t hash = (*sphere->hash_func)(ldc);
+    size_t boundary_index = goalsphere_index(sphere, sphere->num_sets - 1, hash, goalsphere_tag(sphere, ldc));
     if (boundary_index == OUTSIDE) {
       return;
     }
@@ -356,57 +758,320 @@ void update_goalsphere(GoalSphere *sphere, LocDirCube *ldc, size_t depth, size_t
     }
     boundary[boundary_index] = true;
   } else if (depth >= max_depth) {
-    sphere->sets[sphere->num_sets][sphere->set_sizes[sphere->num_sets]] = hash;
-    sphere->set_sizes[sphere->num_sets]++;
+    candidates[*num_candidates] = (*sphere->hash_func)(ldc);
+    if (candidate_tags) {
+      candidate_tags[*num_candidates] = goalsphere_tag(sphere, ldc);
+    }
+    (*num_candidates)++;
     return;
   }
   for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
     LocDirCube child = *ldc;
     locdir_apply_stable(&child, STABLE_MOVES[i]);
-    update_goalsphere(sphere, &child, depth + 1, max_depth, boundary);
+    update_goalsphere(sphere, &child, depth + 1, max_depth, boundary, candidates, candidate_tags, num_candidates, premoves);
+  }
+  if (premoves && depth == max_depth - 1) {
+    for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+      LocDirCube child;
+      locdir_multiply(&child, STABLE_MOVE_CUBES + i, ldc);
+      update_goalsphere(sphere, &child, depth + 1, max_depth, boundary, candidates, candidate_tags, num_candidates, premoves);
+    }
   }
 }
 
-GoalSphere init_goalsphere(LocDirCube *goal, size_t max_depth, size_t (*hash_func)(LocDirCube*)) {
+// Stores the unique candidates that are not in the inner layers as a new outermost layer.
+// The tags of the candidates are only given for tagged spheres.
+void push_goalsphere_layer(GoalSphere *sphere, size_t *candidates, unsigned char *candidate_tags, size_t num_candidates) {
+  if (candidate_tags) {
+    sort_tagged_hashes(candidates, candidate_tags, num_candidates);
+  } else {
+    qsort(candidates, num_candidates, sizeof(size_t), cmp_size_t);
+  }
+
+  size_t depth = sphere->num_sets;
+  sphere->sets = realloc(sphere->sets, (depth + 1) * sizeof(size_t*));
+  sphere->set_sizes = realloc(sphere->set_sizes, (depth + 1) * sizeof(size_t));
+  sphere->sets[depth] = malloc(num_candidates * sizeof(size_t));
+  if (sphere->tags) {
+    sphere->tags = realloc(sphere->tags, (depth + 1) * sizeof(unsigned char*));
+    sphere->tags[depth] = malloc(num_candidates * sizeof(unsigned char));
+  }
+  size_t num_unique = 0;
+  for (size_t i = 0; i < num_candidates; ++i) {
+    unsigned char tag = candidate_tags ? candidate_tags[i] : 0;
+    if (i > 0 && candidates[i] == candidates[i - 1] && (!candidate_tags || tag == candidate_tags[i - 1])) {
+      continue;
+    }
+    if (goalsphere_depth_(sphere, candidates[i], tag) != UNKNOWN) {
+      continue;
+    }
+    sphere->sets[depth][num_unique] = candidates[i];
+    if (sphere->tags) {
+      sphere->tags[depth][num_unique] = tag;
+    }
+    num_unique++;
+  }
+  sphere->sets[depth] = realloc(sphere->sets[depth], num_unique * sizeof(size_t));
+  if (sphere->tags) {
+    sphere->tags[depth] = realloc(sphere->tags[depth], num_unique * sizeof(unsigned char));
+  }
+  sphere->set_sizes[depth] = num_unique;
+  sphere->num_sets++;
+
+  if (sphere->filters) {
+    sphere->filters = realloc(sphere->filters, sphere->num_sets * sizeof(BloomFilter));
+    goalsphere_build_filter(sphere, depth);
+  }
+}
+
+// Adds the next layer by searching from the goal through the existing layers
+void extend_goalsphere_(GoalSphere *sphere, LocDirCube *goal, bool premoves) {
+  if (premoves) {
+    prepare_locdir_orientations();
+  }
+  size_t depth = sphere->num_sets;
+  bool *boundary = calloc(sphere->set_sizes[depth - 1], sizeof(bool));
+  size_t max_candidates = sphere->set_sizes[depth - 1] * NUM_STABLE_MOVES * (premoves ? 2 : 1);
+  size_t *candidates = malloc(max_candidates * sizeof(size_t));
+  unsigned char *candidate_tags = sphere->tags ? malloc(max_candidates * sizeof(unsigned char)) : NULL;
+  size_t num_candidates = 0;
+  update_goalsphere(sphere, goal, 0, depth, boundary, candidates, candidate_tags, &num_candidates, premoves);
+  free(boundary);
+  push_goalsphere_layer(sphere, candidates, candidate_tags, num_candidates);
+  free(candidates);
+  free(candidate_tags);
+}
+
+// Adds layers until the sphere reaches max_depth. The layers already present are kept.
+void extend_goalsphere(GoalSphere *sphere, LocDirCube *goal, size_t max_depth) {
+  while (sphere->num_sets <= max_depth) {
+    extend_goalsphere_(sphere, goal, false);
+  }
+}
+
+// Like extend_goalsphere, but the positions of the outermost layer are recovered from their keys and expanded directly
+// instead of searching from the goal. The keys need to be ranks that the given function inverts.
+// Premoves are needed when the keys identify a position with its inverse, see update_goalsphere.
+void extend_goalsphere_from_keys(GoalSphere *sphere, size_t max_depth, void (*unrank_func)(LocDirCube*, size_t, unsigned char), bool premoves) {
+  prepare_locdir_orientations();
+  while (sphere->num_sets <= max_depth) {
+    size_t last = sphere->num_sets - 1;
+    size_t max_candidates = sphere->set_sizes[last] * NUM_STABLE_MOVES * (premoves ? 2 : 1);
+    size_t *candidates = malloc(max_candidates * sizeof(size_t));
+    unsigned char *candidate_tags = sphere->tags ? malloc(max_candidates * sizeof(unsigned char)) : NULL;
+    size_t num_candidates = 0;
+    for (size_t i = 0; i < sphere->set_sizes[last]; ++i) {
+      LocDirCube ldc;
+      (*unrank_func)(&ldc, sphere->sets[last][i], sphere->tags ? sphere->tags[last][i] : 0);
+      for (size_t j = 0; j < NUM_STABLE_MOVES; ++j) {
+        LocDirCube child = ldc;
+        locdir_apply_stable(&child, STABLE_MOVES[j]);
+        if (candidate_tags) {
+          candidate_tags[num_candidates] = goalsphere_tag(sphere, &child);
+        }
+        candidates[num_candidates++] = (*sphere->hash_func)(&child);
+        if (premoves) {
+          locdir_multiply(&child, STABLE_MOVE_CUBES + j, &ldc);
+          if (candidate_tags) {
+            candidate_tags[num_candidates] = goalsphere_tag(sphere, &child);
+          }
+          candidates[num_candidates++] = (*sphere->hash_func)(&child);
+        }
+      }
+    }
+    push_goalsphere_layer(sphere, candidates, candidate_tags, num_candidates);
+    free(candidates);
+    free(candidate_tags);
+  }
+}
+
+GoalSphere init_goalsphere_(LocDirCube *goal, size_t max_depth, size_t (*hash_func)(LocDirCube*), unsigned char (*tag_func)(LocDirCube*), bool premoves) {
   GoalSphere sphere;
-  sphere.sets = malloc((max_depth + 1) * sizeof(size_t*));
-  sphere.set_sizes = malloc((max_depth + 1) * sizeof(size_t));
+  sphere.sets = malloc(sizeof(size_t*));
+  sphere.tags = (tag_func == NULL) ? NULL : malloc(sizeof(unsigned char*));
+  sphere.filters = NULL;
+  sphere.set_sizes = malloc(sizeof(size_t));
   sphere.num_sets = 0;
   sphere.hash_func = hash_func;
+  sphere.tag_func = tag_func;
 
   sphere.sets[0] = malloc(sizeof(size_t));
   sphere.sets[0][0] = hash_func(goal);
+  if (sphere.tags) {
+    sphere.tags[0] = malloc(sizeof(unsigned char));
+    sphere.tags[0][0] = tag_func(goal);
+  }
   sphere.set_sizes[0] = 1;
   sphere.num_sets++;
 
-  for (size_t depth = 1; depth <= max_depth; ++depth) {
-    bool *boundary = calloc(sphere.set_sizes[depth - 1], sizeof(bool));
-
-    sphere.sets[depth] = malloc(sphere.set_sizes[depth - 1] * NUM_STABLE_MOVES * sizeof(size_t));
-    sphere.set_sizes[depth] = 0;
-    update_goalsphere(&sphere, goal, 0, depth, boundary);
-    free(boundary);
-    qsort(sphere.sets[depth], sphere.set_sizes[depth], sizeof(size_t), cmp_size_t);
-    size_t num_unique = 0;
-    for (size_t i = 0; i < sphere.set_sizes[depth]; ++i) {
-      size_t hash = sphere.sets[depth][i];
-      size_t previous = (i > 0) ? sphere.sets[depth][i-1] : ~hash;
-      if (hash != previous && goalsphere_depth_(&sphere, hash) == UNKNOWN) {
-        sphere.sets[depth][num_unique++] = hash;
-      }
-    }
-    sphere.sets[depth] = realloc(sphere.sets[depth], num_unique * sizeof(size_t));
-    sphere.set_sizes[depth] = num_unique;
-    sphere.num_sets++;
+  while (sphere.num_sets <= max_depth) {
+    extend_goalsphere_(&sphere, goal, premoves);
+  }
+
+  goalsphere_build_filters(&sphere);
+  return sphere;
+}
+
+GoalSphere init_tagged_goalsphere(LocDirCube *goal, size_t max_depth, size_t (*hash_func)(LocDirCube*), unsigned char (*tag_func)(LocDirCube*)) {
+  return init_goalsphere_(goal, max_depth, hash_func, tag_func, false);
+}
+
+// The hash function must be injective
+GoalSphere init_goalsphere(LocDirCube *goal, size_t max_depth, size_t (*hash_func)(LocDirCube*)) {
+  return init_goalsphere_(goal, max_depth, hash_func, NULL, false);
+}
+
+// Sphere around the solved cube that stores one representative per class of positions related by whole-cube rotations
+// and optionally inversion. Queries are canonicalized by the hash and tag functions.
+GoalSphere init_symmetric_goalsphere(size_t max_depth, bool with_inverse) {
+  LocDirCube goal;
+  locdir_reset(&goal);
+  if (with_inverse) {
+    return init_goalsphere_(&goal, max_depth, locdir_symmetric_inverse_hash, locdir_symmetric_inverse_tag, true);
+  }
+  return init_goalsphere_(&goal, max_depth, locdir_symmetric_hash, locdir_symmetric_tag, false);
+}
+
+// Extends a sphere of centerless positions, or of their symmetry representatives, from its outermost layer
+void extend_centerless_goalsphere(GoalSphere *sphere, size_t max_depth) {
+  bool premoves = (sphere->hash_func == locdir_symmetric_inverse_hash);
+  extend_goalsphere_from_keys(sphere, max_depth, locdir_centerless_unrank, premoves);
+}
+
+// "GSPH" in a little endian file
+#define GOALSPHERE_MAGIC (0x48505347)
+#define GOALSPHERE_FORMAT_VERSION (1)
+
+// Identifies the contents of a stored sphere so that a sphere of other keys is not silently misread
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_stable_moves;
+  uint32_t has_tags;
+  // Key of a fixed position to tell hash and tag functions apart
+  uint64_t probe_hash;
+  uint64_t probe_tag;
+} GoalSphereHeader;
+
+GoalSphereHeader goalsphere_header(size_t (*hash_func)(LocDirCube*), unsigned char (*tag_func)(LocDirCube*)) {
+  GoalSphereHeader header;
+  header.magic = GOALSPHERE_MAGIC;
+  header.version = GOALSPHERE_FORMAT_VERSION;
+  header.num_stable_moves = NUM_STABLE_MOVES;
+  header.has_tags = (tag_func != NULL);
+  // Keeps the first two layers solved because some keys are only defined on such positions
+  LocDirCube probe;
+  locdir_reset(&probe);
+  locdir_apply_string(&probe, "R U R' U R U2 R' U");
+  header.probe_hash = (*hash_func)(&probe);
+  header.probe_tag = tag_func == NULL ? 0 : (*tag_func)(&probe);
+  return header;
+}
+
+// Stores a header followed by the number of layers, their sizes and whether tags are present, then the layers and their tags
+void fwrite_goalsphere(GoalSphere *sphere, FILE *fptr) {
+  GoalSphereHeader header = goalsphere_header(sphere->hash_func, sphere->tags == NULL ? NULL : sphere->tag_func);
+  fwrite(&header, sizeof(header), 1, fptr);
+  size_t has_tags = (sphere->tags != NULL);
+  fwrite(&sphere->num_sets, sizeof(size_t), 1, fptr);
+  fwrite(sphere->set_sizes, sizeof(size_t), sphere->num_sets, fptr);
+  fwrite(&has_tags, sizeof(size_t), 1, fptr);
+  for (size_t i = 0; i < sphere->num_sets; ++i) {
+    fwrite(sphere->sets[i], sizeof(size_t), sphere->set_sizes[i], fptr);
   }
+  for (size_t i = 0; has_tags && i < sphere->num_sets; ++i) {
+    fwrite(sphere->tags[i], sizeof(unsigned char), sphere->set_sizes[i], fptr);
+  }
+}
 
+void fread_exactly(void *data, size_t size, size_t count, FILE *fptr) {
+  size_t num_read = fread(data, size, count, fptr);
+  if (num_read != count) {
+    fprintf(stderr, "Failed to load data. Only %zu of %zu read.\n", num_read, count);
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Reads a sphere stored by fwrite_goalsphere. The functions must match the ones it was created with.
+GoalSphere fread_goalsphere(FILE *fptr, size_t (*hash_func)(LocDirCube*), unsigned char (*tag_func)(LocDirCube*)) {
+  GoalSphereHeader expected = goalsphere_header(hash_func, tag_func);
+  GoalSphereHeader header;
+  fread_exactly(&header, sizeof(header), 1, fptr);
+  if (header.magic != expected.magic || header.version != expected.version) {
+    fprintf(stderr, "Not a goal sphere of format version %d. Regenerate it with tabulate.c.\n", GOALSPHERE_FORMAT_VERSION);
+    exit(EXIT_FAILURE);
+  }
+  if (header.num_stable_moves != expected.num_stable_moves) {
+    fprintf(stderr, "Goal sphere was stored with %u stable moves instead of %u.\n", header.num_stable_moves, expected.num_stable_moves);
+    exit(EXIT_FAILURE);
+  }
+  if (header.has_tags != expected.has_tags) {
+    fprintf(stderr, "Tag function does not match the stored sphere.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (header.probe_hash != expected.probe_hash || header.probe_tag != expected.probe_tag) {
+    fprintf(stderr, "Hash function does not match the stored sphere.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GoalSphere sphere;
+  sphere.hash_func = hash_func;
+  sphere.tag_func = tag_func;
+  fread_exactly(&sphere.num_sets, sizeof(size_t), 1, fptr);
+  sphere.set_sizes = malloc(sphere.num_sets * sizeof(size_t));
+  fread_exactly(sphere.set_sizes, sizeof(size_t), sphere.num_sets, fptr);
+  size_t has_tags;
+  fread_exactly(&has_tags, sizeof(size_t), 1, fptr);
+  sphere.sets = malloc(sphere.num_sets * sizeof(size_t*));
+  for (size_t i = 0; i < sphere.num_sets; ++i) {
+    sphere.sets[i] = malloc(sphere.set_sizes[i] * sizeof(size_t));
+    fread_exactly(sphere.sets[i], sizeof(size_t), sphere.set_sizes[i], fptr);
+  }
+  sphere.tags = NULL;
+  if (has_tags) {
+    sphere.tags = malloc(sphere.num_sets * sizeof(unsigned char*));
+    for (size_t i = 0; i < sphere.num_sets; ++i) {
+      sphere.tags[i] = malloc(sphere.set_sizes[i] * sizeof(unsigned char));
+      fread_exactly(sphere.tags[i], sizeof(unsigned char), sphere.set_sizes[i], fptr);
+    }
+  }
+  goalsphere_build_filters(&sphere);
   return sphere;
 }
 
+bool save_goalsphere(GoalSphere *sphere, const char *path) {
+  FILE *fptr = fopen(path, "wb");
+  if (fptr == NULL) {
+    return false;
+  }
+  fwrite_goalsphere(sphere, fptr);
+  fclose(fptr);
+  return true;
+}
+
+// Returns false if there is no sphere stored at the path
+bool load_goalsphere(GoalSphere *sphere, const char *path, size_t (*hash_func)(LocDirCube*), unsigned char (*tag_func)(LocDirCube*)) {
+  FILE *fptr = fopen(path, "rb");
+  if (fptr == NULL) {
+    return false;
+  }
+  *sphere = fread_goalsphere(fptr, hash_func, tag_func);
+  fclose(fptr);
+  return true;
+}
+
 void free_goalsphere(GoalSphere *sphere) {
   for (size_t i = 0; i < sphere->num_sets; ++i) {
     free(sphere->sets[i]);
+    if (sphere->tags) {
+      free(sphere->tags[i]);
+    }
+    if (sphere->filters) {
+      free_bloom_filter(sphere->filters + i);
+    }
   }
+  free(sphere->filters);
   free(sphere->sets);
+  free(sphere->tags);
   free(sphere->set_sizes);
 }
@@ -1,305 +1,527 @@
 #define LOG_IDA_STAR_PROGRESS 0
 
-typedef struct {
-  LocDirCube path[SEQUENCE_MAX_LENGTH];
-  size_t path_length;
-  bool (*is_solved)(LocDirCube*);
-  unsigned char (*estimator)(LocDirCube*);
-} IDAstar;
+// Count the nodes, cutoffs, goal tests and time of the iterations for each bound.
+// Costs a few increments per node and makes IDAstar larger so it is compiled out unless enabled.
+#define IDA_STAR_INSTRUMENTATION (0)
+
+// Move ordering flags. Without any the children are expanded in STABLE_MOVES (i.e. priority) order.
+#define ORDER_BY_ESTIMATE (1)
+#define ORDER_BY_KILLERS (2)
+#define ORDER_BY_HISTORY (4)
+
+// Estimators may count how often each of their stages is probed and how often it cuts the node off
+#define MAX_ESTIMATOR_STAGES (8)
+
+// Number of nodes a search estimates between checks of its budget and of cancellation
+#define IDA_STAR_CHECK_INTERVAL (1 << 10)
 
 const unsigned char FOUND = 254;
 const unsigned char SKIP = 253;
+const unsigned char ABORTED = 252;
 
-unsigned char ida_star_search(IDAstar *ida, unsigned char so_far, unsigned char bound) {
-  LocDirCube *ldc = ida->path + (ida->path_length - 1);
-  unsigned char to_go = (*ida->estimator)(ldc);
-  unsigned char lower_bound = so_far + to_go;
-  if (lower_bound > bound) {
-    return lower_bound;
+// Limits shared by all the searches of a solve, including the members of a parallel team.
+// The searches give up once any of them is exceeded.
+typedef struct {
+  // Seconds on the monotonic clock of search_clock(). Zero for no deadline.
+  double deadline;
+  // Zero for no limit
+  size_t max_nodes;
+  // Iterations with a larger bound are not started
+  unsigned char max_bound;
+  // Nodes reported by the searches so far
+  size_t num_nodes;
+  bool exhausted;
+} SearchBudget;
+
+double search_clock() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+// Zero for either limit means no limit
+SearchBudget init_search_budget(double time_budget, size_t max_nodes) {
+  SearchBudget budget;
+  budget.deadline = time_budget > 0 ? search_clock() + time_budget : 0;
+  budget.max_nodes = max_nodes;
+  budget.max_bound = UNKNOWN;
+  budget.num_nodes = 0;
+  budget.exhausted = false;
+  return budget;
+}
+
+typedef struct {
+  size_t probes;
+  size_t hits;
+  size_t stores;
+  size_t evictions;
+} TranspositionStats;
+
+// Lock-free table of states whose subtrees have been exhausted during the current iteration.
+// Each entry is stored as (key ^ data, data) so that torn writes from concurrent threads fail the key check.
+typedef struct {
+  size_t *words;
+  size_t num_entries;
+  size_t (*hash_func)(LocDirCube*);
+  // Incremented for every IDA* iteration. Entries from earlier iterations are stale.
+  size_t age;
+} TranspositionTable;
+
+// The number of entries is the largest power of two fitting in the given number of bytes
+TranspositionTable init_transposition_table(size_t num_bytes, size_t (*hash_func)(LocDirCube*)) {
+  TranspositionTable table;
+  table.num_entries = 1;
+  while (4 * table.num_entries * sizeof(size_t) <= num_bytes) {
+    table.num_entries *= 2;
   }
-  if (to_go == 0 && (*ida->is_solved)(ldc)) {
-    return FOUND;
+  table.words = calloc(2 * table.num_entries, sizeof(size_t));
+  if (table.words == NULL) {
+    fprintf(stderr, "Failed to allocate transposition table of %zu bytes.\n", num_bytes);
+    exit(EXIT_FAILURE);
   }
-  unsigned char min = UNKNOWN;
-  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
-    ida->path[ida->path_length] = *ldc;
-    locdir_apply_stable(ida->path + ida->path_length, STABLE_MOVES[i]);
-
-    bool in_path = false;
-    for (size_t j = 0; j < ida->path_length; ++j) {
-      if (locdir_equals(ida->path + ida->path_length, ida->path + j)) {
-        in_path = true;
-        break;
-      }
-    }
-    if (in_path) {
-      continue;
-    }
+  table.hash_func = hash_func;
+  table.age = 0;
+  return table;
+}
 
-    ida->path_length++;
-    unsigned char child_result = ida_star_search(ida, so_far + 1, bound);
-    if (child_result == FOUND) {
-      return FOUND;
-    }
-    if (child_result < min) {
-      min = child_result;
-    }
-    ida->path_length--;
-  }
-  return min;
+void free_transposition_table(TranspositionTable *table) {
+  free(table->words);
 }
 
-void ida_star_solve(IDAstar *ida, LocDirCube *ldc, unsigned char lower_bound) {
-  ida->path[0] = *ldc;
-  ida->path_length = 1;
+size_t transposition_slot(TranspositionTable *table, size_t key) {
+  return ((key * 0x9E3779B97F4A7C15ULL) >> 20) & (table->num_entries - 1);
+}
 
-  unsigned char bound = (*ida->estimator)(ida->path);
+// Entry data: age in the high bits, then the depth the state was searched at and the resulting bound
+size_t transposition_data(size_t age, unsigned char so_far, unsigned char result) {
+  return (age << 16) | (so_far << 8) | result;
+}
 
-  if (lower_bound > bound) {
-    bound = lower_bound;
+// Returns the bound of an exhausted subtree if the state has already been searched at the same or a lower depth
+unsigned char transposition_probe(TranspositionTable *table, TranspositionStats *stats, size_t key, unsigned char so_far) {
+  stats->probes++;
+  size_t *entry = table->words + 2 * transposition_slot(table, key);
+  size_t check = __atomic_load_n(entry, __ATOMIC_RELAXED);
+  size_t data = __atomic_load_n(entry + 1, __ATOMIC_RELAXED);
+  if ((check ^ data) != key || (data >> 16) != table->age) {
+    return SKIP;
   }
-
-  for (;;) {
-    #if LOG_IDA_STAR_PROGRESS
-    printf("IDA* bound = %d\n", bound);
-    #endif
-    unsigned char search_result = ida_star_search(ida, 0, bound);
-    if (search_result == FOUND) {
-      // Solution is stored in ida->path.
-      return;
-    }
-    bound = search_result;
+  unsigned char stored_so_far = (data >> 8) & 0xFF;
+  unsigned char result = data & 0xFF;
+  if (so_far < stored_so_far) {
+    return SKIP;
   }
+  stats->hits++;
+  if (result == UNKNOWN) {
+    return UNKNOWN;
+  }
+  return result + (so_far - stored_so_far);
 }
 
-void ida_star_solve_parallel(IDAstar *ida, LocDirCube *ldc, unsigned char lower_bound) {
-  ida->path[0] = *ldc;
-  ida->path_length = 1;
-  // Check if already solved
-  if ((*ida->is_solved)(ldc)) {
-    return;
+void transposition_store(TranspositionTable *table, TranspositionStats *stats, size_t key, unsigned char so_far, unsigned char result) {
+  stats->stores++;
+  size_t *entry = table->words + 2 * transposition_slot(table, key);
+  size_t check = __atomic_load_n(entry, __ATOMIC_RELAXED);
+  size_t data = __atomic_load_n(entry + 1, __ATOMIC_RELAXED);
+  if ((data >> 16) == table->age && (check ^ data) != key) {
+    stats->evictions++;
   }
+  data = transposition_data(table->age, so_far, result);
+  __atomic_store_n(entry, key ^ data, __ATOMIC_RELAXED);
+  __atomic_store_n(entry + 1, data, __ATOMIC_RELAXED);
+}
 
-  unsigned char bound = (*ida->estimator)(ida->path);
+void transposition_stats_add(TranspositionStats *total, TranspositionStats *stats) {
+  total->probes += stats->probes;
+  total->hits += stats->hits;
+  total->stores += stats->stores;
+  total->evictions += stats->evictions;
+}
 
-  if (lower_bound > bound) {
-    bound = lower_bound;
-  }
+void fprint_transposition_stats(FILE *file, TranspositionStats *stats) {
+  fprintf(
+    file,
+    "Transposition table: %zu probes, %zu hits, %zu stores, %zu evictions\n",
+    stats->probes,
+    stats->hits,
+    stats->stores,
+    stats->evictions
+  );
+}
 
-  IDAstar ida_team[NUM_STABLE_MOVES * NUM_STABLE_MOVES];
-  for (int i = 0; i < NUM_STABLE_MOVES; ++i) {
-    for (int j = 0; j < NUM_STABLE_MOVES; ++j) {
-      int idx = i * NUM_STABLE_MOVES + j;
-      ida_team[idx].path[0] = *ldc;
-      ida_team[idx].path[1] = ida_team[idx].path[0];
-      locdir_apply_stable(ida_team[idx].path + 1, STABLE_MOVES[i]);
-      ida_team[idx].path[2] = ida_team[idx].path[1];
-      locdir_apply_stable(ida_team[idx].path + 2, STABLE_MOVES[j]);
-      ida_team[idx].path_length = 3;
+// Statistics of all the iterations with the same bound
+typedef struct {
+  size_t num_iterations;
+  // Calls to the search function
+  size_t visited;
+  // Nodes whose children were generated
+  size_t expanded;
+  // Nodes whose estimate exceeded the bound
+  size_t cutoffs;
+  // Goal tests of nodes estimated to be solved and how many of them passed
+  size_t goal_probes;
+  size_t goal_hits;
+  double seconds;
+} BoundStats;
+
+// Larger bounds share the last entry
+#define IDA_STAR_NUM_BOUND_STATS (SEQUENCE_MAX_LENGTH + 1)
+
+#if IDA_STAR_INSTRUMENTATION
+#define IDA_STAR_BOUND_STATS(ida, bound) ((ida)->bound_stats + ((bound) < IDA_STAR_NUM_BOUND_STATS ? (bound) : IDA_STAR_NUM_BOUND_STATS - 1))
+#define IDA_STAR_COUNT(ida, bound, counter) (IDA_STAR_BOUND_STATS(ida, bound)->counter++)
+#else
+#define IDA_STAR_COUNT(ida, bound, counter) ((void) 0)
+#endif
 
-      ida_team[idx].is_solved = ida->is_solved;
-      ida_team[idx].estimator = ida->estimator;
-    }
+typedef struct {
+  LocDirCube root;
+  // Working state that moves are applied to and undone from in place
+  LocDirCube state;
+  // Indices into STABLE_MOVES
+  unsigned char moves[SEQUENCE_MAX_LENGTH];
+  // Fingerprints of the states along the path with fingerprints[0] belonging to the root
+  size_t fingerprints[SEQUENCE_MAX_LENGTH + 1];
+  size_t num_moves;
+  bool (*is_solved)(LocDirCube*);
+  unsigned char (*estimator)(LocDirCube*);
+  unsigned char move_ordering;
+  // Move at each ply that led closest to a solution during the previous iterations
+  unsigned char killers[SEQUENCE_MAX_LENGTH];
+  // Accumulated success of each move weighted by the remaining depth
+  size_t history[NUM_STABLE_MOVES];
+  // Optional and possibly shared between threads
+  TranspositionTable *table;
+  TranspositionStats table_stats;
+  // Also bound the distance by the estimate of the inverse of the working state.
+  // Only valid for full cubes and estimators of the distance to the solved state.
+  bool track_inverse;
+  LocDirCube inverse;
+  // Bound of the current or the last iteration. No solution is shorter.
+  unsigned char bound;
+  // Optional and possibly shared between threads
+  SearchBudget *budget;
+  // Value of num_nodes at the last check of the budget and of cancellation
+  size_t last_check;
+  // Number of states estimated
+  size_t num_nodes;
+  size_t stage_probes[MAX_ESTIMATOR_STAGES];
+  size_t stage_cuts[MAX_ESTIMATOR_STAGES];
+  #if IDA_STAR_INSTRUMENTATION
+  BoundStats bound_stats[IDA_STAR_NUM_BOUND_STATS];
+  #endif
+} IDAstar;
+
+// Snapshot of the statistics of a search. The bound statistics stay zero without IDA_STAR_INSTRUMENTATION.
+typedef struct {
+  size_t num_nodes;
+  size_t stage_probes[MAX_ESTIMATOR_STAGES];
+  size_t stage_cuts[MAX_ESTIMATOR_STAGES];
+  TranspositionStats table_stats;
+  BoundStats bound_stats[IDA_STAR_NUM_BOUND_STATS];
+} SearchStats;
+
+void ida_star_clear_stats(IDAstar *ida) {
+  ida->table_stats = (TranspositionStats) {0};
+  ida->num_nodes = 0;
+  ida->last_check = 0;
+  for (size_t i = 0; i < MAX_ESTIMATOR_STAGES; ++i) {
+    ida->stage_probes[i] = 0;
+    ida->stage_cuts[i] = 0;
+  }
+  #if IDA_STAR_INSTRUMENTATION
+  for (size_t i = 0; i < IDA_STAR_NUM_BOUND_STATS; ++i) {
+    ida->bound_stats[i] = (BoundStats) {0};
   }
+  #endif
+}
 
-  // Check if the first move already solves
-  for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
-    if ((*ida->is_solved)(ida_team[i].path + 1)) {
-      ida->path[0] = ida_team[i].path[0];
-      ida->path[1] = ida_team[i].path[1];
-      ida->path_length = 2;
-      return;
-    }
+// Adds the statistics of another search (e.g. a member of a parallel team) to the total
+void ida_star_merge_stats(IDAstar *total, IDAstar *ida) {
+  transposition_stats_add(&total->table_stats, &ida->table_stats);
+  total->num_nodes += ida->num_nodes;
+  for (size_t i = 0; i < MAX_ESTIMATOR_STAGES; ++i) {
+    total->stage_probes[i] += ida->stage_probes[i];
+    total->stage_cuts[i] += ida->stage_cuts[i];
   }
-  // Check if the second move already solves
-  for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
-    if ((*ida->is_solved)(ida_team[i].path + 2)) {
-      ida->path[0] = ida_team[i].path[0];
-      ida->path[1] = ida_team[i].path[1];
-      ida->path[2] = ida_team[i].path[2];
-      ida->path_length = 3;
-      return;
-    }
+  #if IDA_STAR_INSTRUMENTATION
+  for (size_t i = 0; i < IDA_STAR_NUM_BOUND_STATS; ++i) {
+    BoundStats *a = total->bound_stats + i;
+    BoundStats *b = ida->bound_stats + i;
+    a->num_iterations += b->num_iterations;
+    a->visited += b->visited;
+    a->expanded += b->expanded;
+    a->cutoffs += b->cutoffs;
+    a->goal_probes += b->goal_probes;
+    a->goal_hits += b->goal_hits;
+    a->seconds += b->seconds;
   }
+  #endif
+}
+
+SearchStats ida_star_stats(IDAstar *ida) {
+  SearchStats stats = {0};
+  stats.num_nodes = ida->num_nodes;
+  for (size_t i = 0; i < MAX_ESTIMATOR_STAGES; ++i) {
+    stats.stage_probes[i] = ida->stage_probes[i];
+    stats.stage_cuts[i] = ida->stage_cuts[i];
+  }
+  stats.table_stats = ida->table_stats;
+  #if IDA_STAR_INSTRUMENTATION
+  for (size_t i = 0; i < IDA_STAR_NUM_BOUND_STATS; ++i) {
+    stats.bound_stats[i] = ida->bound_stats[i];
+  }
+  #endif
+  return stats;
+}
 
-  unsigned char team_results[NUM_STABLE_MOVES * NUM_STABLE_MOVES] = {0};
-  size_t num_members = 0;
-  for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
-    // Skip backtracking
-    if (
-      locdir_equals(ida_team[i].path, ida_team[i].path + 1) ||
-      locdir_equals(ida_team[i].path, ida_team[i].path + 2) ||
-      locdir_equals(ida_team[i].path + 1, ida_team[i].path + 2)
-    ) {
-      // printf("%d = (%d, %d) backtracks\n", i, i % NUM_STABLE_MOVES, i / NUM_STABLE_MOVES);
-      team_results[i] = SKIP;
+/*
+Writes the statistics as JSON lines: one line for every bound that was iterated and a summary line.
+The stage names label the estimator stages. Every line carries the label of the search.
+*/
+void fprint_search_stats_json(FILE *file, SearchStats *stats, const char *label, const char **stage_names, size_t num_stages) {
+  double seconds = 0;
+  for (size_t i = 0; i < IDA_STAR_NUM_BOUND_STATS; ++i) {
+    BoundStats *bound = stats->bound_stats + i;
+    seconds += bound->seconds;
+    if (!bound->num_iterations) {
       continue;
     }
-    // Skip duplicates
-    for (int j = 0; j < i; ++j) {
-      if (team_results[j] == SKIP) {
-        continue;
-      }
-      if (
-        locdir_equals(ida_team[i].path + 2, ida_team[j].path + 1) ||
-        locdir_equals(ida_team[i].path + 2, ida_team[j].path + 2)
-      ) {
-        // printf("%d = (%d, %d) is a duplicate\n", i, i % NUM_STABLE_MOVES, i / NUM_STABLE_MOVES);
-        team_results[i] = SKIP;
-        break;
-      }
-    }
-    if (team_results[i] != SKIP) {
-      num_members++;
-    }
+    fprintf(
+      file,
+      "{\"search\": \"%s\", \"bound\": %zu, \"iterations\": %zu, \"visited\": %zu, \"expanded\": %zu, \"cutoffs\": %zu, "
+      "\"goal_probes\": %zu, \"goal_hits\": %zu, \"seconds\": %g, \"visited_per_second\": %g}\n",
+      label,
+      i,
+      bound->num_iterations,
+      bound->visited,
+      bound->expanded,
+      bound->cutoffs,
+      bound->goal_probes,
+      bound->goal_hits,
+      bound->seconds,
+      bound->seconds > 0 ? bound->visited / bound->seconds : 0.0
+    );
+  }
+  fprintf(file, "{\"search\": \"%s\", \"nodes\": %zu", label, stats->num_nodes);
+  if (seconds > 0) {
+    fprintf(file, ", \"seconds\": %g, \"nodes_per_second\": %g", seconds, stats->num_nodes / seconds);
+  }
+  fprintf(file, ", \"stages\": {");
+  for (size_t i = 0; i < num_stages; ++i) {
+    fprintf(file, "%s\"%s\": {\"probes\": %zu, \"cuts\": %zu}", i ? ", " : "", stage_names[i], stats->stage_probes[i], stats->stage_cuts[i]);
   }
+  fprintf(
+    file,
+    "}, \"table\": {\"probes\": %zu, \"hits\": %zu, \"stores\": %zu, \"evictions\": %zu}}\n",
+    stats->table_stats.probes,
+    stats->table_stats.hits,
+    stats->table_stats.stores,
+    stats->table_stats.evictions
+  );
+}
 
-  #if LOG_IDA_STAR_PROGRESS
-  printf("%zu members in IDA* team\n", num_members);
-  #endif
+// The largest estimate that does not cut off a node at the given depth
+unsigned char ida_star_limit(unsigned char so_far, unsigned char bound) {
+  return bound > so_far ? bound - so_far : 0;
+}
 
+IDAstar init_ida_star(bool (*is_solved)(LocDirCube*), unsigned char (*estimator)(LocDirCube*)) {
+  IDAstar ida;
+  ida.num_moves = 0;
+  ida.is_solved = is_solved;
+  ida.estimator = estimator;
+  ida.move_ordering = 0;
+  ida.table = NULL;
+  ida.track_inverse = false;
+  ida.bound = 0;
+  ida.budget = NULL;
+  ida_star_clear_stats(&ida);
+  return ida;
+}
 
-  for (;;) {
-    #if LOG_IDA_STAR_PROGRESS
-    printf("IDA* bound = %d\n", bound);
-    #endif
-    bool found = false;
-    #pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
-      if (team_results[i] == SKIP || found) {
-        continue;
-      }
-      team_results[i] = ida_star_search(ida_team + i, 2, bound);
-      if (team_results[i] == FOUND) {
-        found = true;
-      }
-    }
+// Limit the following solves by the budget or lift the limits with NULL
+void ida_star_set_budget(IDAstar *ida, SearchBudget *budget) {
+  ida->budget = budget;
+  ida->last_check = ida->num_nodes;
+}
 
-    bound = UNKNOWN;
-    for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
-      if (team_results[i] == SKIP) {
-        continue;
-      }
-      if (team_results[i] == FOUND) {
-        // Store result in ida->path
-        ida->path_length = ida_team[i].path_length;
-        for (int j = 0; j < ida->path_length; ++j) {
-          ida->path[j] = ida_team[i].path[j];
-        }
-        return;
-      }
-      bound = team_results[i] < bound ? team_results[i] : bound;
-    }
+// Called every IDA_STAR_CHECK_INTERVAL nodes. Reports the nodes since the last check to the budget.
+bool ida_star_interrupted(IDAstar *ida) {
+  size_t num_new_nodes = ida->num_nodes - ida->last_check;
+  ida->last_check = ida->num_nodes;
+  if (search_cancelled()) {
+    return true;
+  }
+  SearchBudget *budget = ida->budget;
+  if (budget == NULL) {
+    return false;
+  }
+  size_t num_nodes = __atomic_add_fetch(&budget->num_nodes, num_new_nodes, __ATOMIC_RELAXED);
+  if ((budget->max_nodes && num_nodes >= budget->max_nodes) || (budget->deadline && search_clock() > budget->deadline)) {
+    __atomic_store_n(&budget->exhausted, true, __ATOMIC_RELAXED);
   }
+  return __atomic_load_n(&budget->exhausted, __ATOMIC_RELAXED);
 }
 
-sequence ida_to_sequence(IDAstar *ida) {
-  if (ida->path_length < 1) {
-    return INVALID;
+// True once the search has been interrupted by its budget or by cancellation
+static inline bool ida_star_stopped(IDAstar *ida) {
+  return search_cancelled() || (ida->budget && __atomic_load_n(&ida->budget->exhausted, __ATOMIC_RELAXED));
+}
+
+void ida_star_reset(IDAstar *ida, LocDirCube *ldc) {
+  prepare_locdir_orientations();
+  ida->root = *ldc;
+  ida->state = *ldc;
+  ida->num_moves = 0;
+  ida->fingerprints[0] = locdir_fingerprint(ldc);
+  if (ida->track_inverse) {
+    locdir_invert(&ida->inverse, ldc);
+  }
+  for (size_t i = 0; i < SEQUENCE_MAX_LENGTH; ++i) {
+    ida->killers[i] = NUM_STABLE_MOVES;
   }
-  LocDirCube ldc = ida->path[0];
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    ida->history[i] = 0;
+  }
+}
 
-  sequence seq = I;
+// The inverse of the state after a move is the inverse move followed by the inverse of the state before it
+void ida_star_update_inverse(IDAstar *ida, size_t move_index) {
+  LocDirCube inverse = ida->inverse;
+  locdir_multiply(&ida->inverse, STABLE_MOVE_CUBES + STABLE_MOVE_INVERSES[move_index], &inverse);
+}
 
-  for (size_t i = 0; i < ida->path_length; ++i) {
-    for (enum move move = U; move < MAX_MOVE; ++move) {
-      LocDirCube child = ldc;
-      locdir_apply(&child, move);
-      locdir_realign(&child);
-      if (locdir_equals(&child, ida->path + i)) {
-        seq = move + NUM_MOVES * seq;
-        locdir_apply(&ldc, move);
-        break;
-      }
-    }
+void ida_star_push(IDAstar *ida, size_t move_index) {
+  locdir_apply_stable(&ida->state, STABLE_MOVES[move_index]);
+  ida->moves[ida->num_moves++] = move_index;
+  ida->fingerprints[ida->num_moves] = locdir_fingerprint(&ida->state);
+  if (ida->track_inverse) {
+    ida_star_update_inverse(ida, move_index);
   }
+}
 
-  return seq;
+// Undoes the last move by restoring the saved parent state
+void ida_star_pop(IDAstar *ida, LocDirCube *parent) {
+  ida->state = *parent;
+  ida->num_moves--;
+  if (ida->track_inverse) {
+    ida_star_update_inverse(ida, STABLE_MOVE_INVERSES[ida->moves[ida->num_moves]]);
+  }
 }
 
-collection ida_star_search_all_stable(IDAstar *ida, unsigned char so_far, unsigned char bound) {
-  unsigned char to_go = (*ida->estimator)(ida->path + ida->path_length - 1);
-  unsigned char lower_bound = so_far + to_go;
-  if (lower_bound > bound) {
-    return NULL;
-  }
-  if (to_go == 0 && (*ida->is_solved)(ida->path + ida->path_length - 1)) {
-    collection result = malloc(2 * sizeof(sequence));
-    result[0] = I;
-    result[1] = SENTINEL;
-    return result;
-  }
-  int min = UNKNOWN;
-  collection child_results[NUM_STABLE_MOVES];
-  size_t num_child_results = 0;
-  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
-    ida->path[ida->path_length] = ida->path[ida->path_length - 1];
-    locdir_apply_stable(ida->path + ida->path_length, STABLE_MOVES[i]);
-
-    bool in_path = false;
-    for (size_t j = 0; j < ida->path_length; ++j) {
-      if (locdir_equals(ida->path + ida->path_length, ida->path + j)) {
-        in_path = true;
-        break;
-      }
-    }
-    if (in_path) {
+// Checks if the state after moves[num_moves] has been visited earlier on the path.
+// Fingerprint matches are confirmed by undoing moves back to the candidate ancestor.
+bool ida_star_revisits(IDAstar *ida, LocDirCube *parent, size_t fingerprint) {
+  if (ida->fingerprints[ida->num_moves] == fingerprint && locdir_equals(parent, &ida->state)) {
+    return true;
+  }
+  for (size_t j = 0; j < ida->num_moves; ++j) {
+    if (ida->fingerprints[j] != fingerprint) {
       continue;
     }
-
-    ida->path_length++;
-    collection child_result = ida_star_search_all_stable(ida, so_far + 1, bound);
-    if (child_result != NULL) {
-      int child_length = sequence_length(child_result[0]);
-      if (child_length > min) {
-        free(child_result);
-      }
-      if (child_length < min) {
-        min = child_length;
-        for (size_t k = 0; k < num_child_results; ++k) {
-          free(child_results[k]);
-        }
-        num_child_results = 0;
-      }
-      if (child_length <= min) {
-        collection it = child_result;
-        while (*it != SENTINEL) {
-          *it = concat(STABLE_MOVES[i], *it);
-          it++;
-        }
-        child_results[num_child_results++] = child_result;
-      }
+    LocDirCube ancestor = *parent;
+    for (size_t k = ida->num_moves; k > j; --k) {
+      locdir_apply_stable(&ancestor, STABLE_MOVES[STABLE_MOVE_INVERSES[ida->moves[k - 1]]]);
     }
+    if (locdir_equals(&ancestor, &ida->state)) {
+      return true;
+    }
+  }
+  return false;
+}
 
-    ida->path_length--;
+// Applies the given move to the working state unless it leads back to a state on the path
+bool ida_star_try_push(IDAstar *ida, LocDirCube *parent, size_t move_index) {
+  // Undoing the previous move always revisits
+  if (ida->num_moves && STABLE_MOVE_INVERSES[ida->moves[ida->num_moves - 1]] == move_index) {
+    return false;
   }
+  locdir_apply_stable(&ida->state, STABLE_MOVES[move_index]);
+  size_t fingerprint = locdir_fingerprint(&ida->state);
+  if (ida_star_revisits(ida, parent, fingerprint)) {
+    ida->state = *parent;
+    return false;
+  }
+  ida->moves[ida->num_moves++] = move_index;
+  ida->fingerprints[ida->num_moves] = fingerprint;
+  if (ida->track_inverse) {
+    ida_star_update_inverse(ida, move_index);
+  }
+  return true;
+}
 
-  size_t num_solutions = 0;
-  for (size_t i = 0; i < num_child_results; ++i) {
-    num_solutions += collection_size(child_results[i]);
+// Pushes a child state previously obtained with ida_star_try_push
+void ida_star_push_child(IDAstar *ida, size_t move_index, LocDirCube *child, LocDirCube *child_inverse, size_t fingerprint) {
+  ida->state = *child;
+  ida->moves[ida->num_moves++] = move_index;
+  ida->fingerprints[ida->num_moves] = fingerprint;
+  if (ida->track_inverse) {
+    ida->inverse = *child_inverse;
   }
+}
 
-  collection result = malloc((num_solutions+1) * sizeof(sequence));
-  num_solutions = 0;
+// Estimate of the working state using the estimator function pointer. Always complete so the limit is unused.
+unsigned char ida_star_estimate(IDAstar *ida, unsigned char limit) {
+  ida->num_nodes++;
+  unsigned char estimate = (*ida->estimator)(&ida->state);
+  if (ida->track_inverse) {
+    unsigned char inverse_estimate = (*ida->estimator)(&ida->inverse);
+    if (inverse_estimate > estimate) {
+      return inverse_estimate;
+    }
+  }
+  return estimate;
+}
 
-  for (size_t i = 0; i < num_child_results; ++i) {
-    collection it = child_results[i];
-    while (*it != SENTINEL) {
-      result[num_solutions++] = *it;
-      it++;
+bool ida_star_precedes(IDAstar *ida, unsigned char a, unsigned char b, unsigned char *estimates) {
+  if ((ida->move_ordering & ORDER_BY_ESTIMATE) && estimates[a] != estimates[b]) {
+    return estimates[a] < estimates[b];
+  }
+  if (ida->move_ordering & ORDER_BY_KILLERS) {
+    unsigned char killer = ida->killers[ida->num_moves];
+    if (a == killer || b == killer) {
+      return a == killer;
     }
-    free(child_results[i]);
   }
-  result[num_solutions] = SENTINEL;
+  if ((ida->move_ordering & ORDER_BY_HISTORY) && ida->history[a] != ida->history[b]) {
+    return ida->history[a] > ida->history[b];
+  }
+  return a < b;
+}
 
-  return result;
+// Sorts the children (given as move indices) into the order they should be expanded in
+void ida_star_order_children(IDAstar *ida, unsigned char *children, size_t num_children, unsigned char *estimates) {
+  for (size_t i = 1; i < num_children; ++i) {
+    unsigned char child = children[i];
+    size_t j = i;
+    while (j > 0 && ida_star_precedes(ida, child, children[j - 1], estimates)) {
+      children[j] = children[j - 1];
+      j--;
+    }
+    children[j] = child;
+  }
 }
 
-collection ida_star_solve_all_stable(IDAstar *ida, LocDirCube *ldc, unsigned char lower_bound) {
-  // Obtain the correct bound iteratively
-  ida_star_solve(ida, ldc, lower_bound);
+// Remembers that the given move at the current ply led closest to a solution
+void ida_star_reward(IDAstar *ida, size_t move_index, unsigned char remaining) {
+  ida->killers[ida->num_moves] = move_index;
+  ida->history[move_index] += 1ULL << remaining;
+}
 
-  unsigned char bound = ida->path_length - 1;
-  ida->path_length = 1;
-  return ida_star_search_all_stable(ida, 0, bound);
+sequence ida_to_sequence(IDAstar *ida) {
+  sequence seq = I;
+  unsigned char orientation = 0;
+  for (size_t i = 0; i < ida->num_moves; ++i) {
+    StableExpansion *expansion = &LOCDIR_STABLE_EXPANSIONS[orientation][STABLE_MOVES[ida->moves[i]]];
+    seq = expansion->moves[0] + NUM_MOVES * seq;
+    orientation = expansion->orientations[0];
+  }
+  return seq;
 }
+
+// Generic kernels calling through the function pointers in IDAstar
+#define IDA_KERNEL(name) name
+#define IDA_KERNEL_ESTIMATOR(ida, limit) ida_star_estimate(ida, limit)
+#define IDA_KERNEL_IS_SOLVED(ida, ldc) (*(ida)->is_solved)(ldc)
+#include "ida_star_kernel.c"
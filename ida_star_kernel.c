@@ -0,0 +1,430 @@
+// Search kernels instantiated once per estimator configuration so that the compiler can inline the estimator and goal test.
+// Define IDA_KERNEL(name) to produce the function names, IDA_KERNEL_ESTIMATOR(ida, limit) to estimate the working state ida->state
+// and IDA_KERNEL_IS_SOLVED(ida, ldc) to produce the goal test before including this file.
+// The estimator may return early with any admissible value above the limit. IDA_KERNEL_HASH(ida, ldc) may be defined to specialize the transposition table key.
+
+#ifndef IDA_KERNEL_HASH
+#define IDA_KERNEL_HASH(ida, ldc) (*(ida)->table->hash_func)(ldc)
+#endif
+
+unsigned char IDA_KERNEL(ida_star_search)(IDAstar *ida, unsigned char so_far, unsigned char bound) {
+  if (ida->num_nodes - ida->last_check >= IDA_STAR_CHECK_INTERVAL && ida_star_interrupted(ida)) {
+    return ABORTED;
+  }
+  IDA_STAR_COUNT(ida, bound, visited);
+  unsigned char to_go = IDA_KERNEL_ESTIMATOR(ida, ida_star_limit(so_far, bound));
+  unsigned char lower_bound = so_far + to_go;
+  if (lower_bound > bound) {
+    IDA_STAR_COUNT(ida, bound, cutoffs);
+    return lower_bound;
+  }
+  if (to_go == 0) {
+    IDA_STAR_COUNT(ida, bound, goal_probes);
+    if (IDA_KERNEL_IS_SOLVED(ida, &ida->state)) {
+      IDA_STAR_COUNT(ida, bound, goal_hits);
+      return FOUND;
+    }
+  }
+  size_t key = 0;
+  if (ida->table) {
+    key = IDA_KERNEL_HASH(ida, &ida->state);
+    unsigned char known = transposition_probe(ida->table, &ida->table_stats, key, so_far);
+    if (known != SKIP) {
+      return known;
+    }
+  }
+  IDA_STAR_COUNT(ida, bound, expanded);
+  unsigned char min = UNKNOWN;
+  LocDirCube parent = ida->state;
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    if (!ida_star_try_push(ida, &parent, i)) {
+      continue;
+    }
+    unsigned char child_result = IDA_KERNEL(ida_star_search)(ida, so_far + 1, bound);
+    if (child_result == FOUND || child_result == ABORTED) {
+      return child_result;
+    }
+    if (child_result < min) {
+      min = child_result;
+    }
+    ida_star_pop(ida, &parent);
+  }
+  if (ida->table) {
+    transposition_store(ida->table, &ida->table_stats, key, so_far, min);
+  }
+  return min;
+}
+
+// Variant of the above that expands children in the order given by ida->move_ordering.
+// The estimate of the current state is computed by the caller so that every child is only estimated once.
+unsigned char IDA_KERNEL(ida_star_search_ordered)(IDAstar *ida, unsigned char so_far, unsigned char bound, unsigned char to_go) {
+  if (ida->num_nodes - ida->last_check >= IDA_STAR_CHECK_INTERVAL && ida_star_interrupted(ida)) {
+    return ABORTED;
+  }
+  IDA_STAR_COUNT(ida, bound, visited);
+  unsigned char lower_bound = so_far + to_go;
+  if (lower_bound > bound) {
+    IDA_STAR_COUNT(ida, bound, cutoffs);
+    return lower_bound;
+  }
+  if (to_go == 0) {
+    IDA_STAR_COUNT(ida, bound, goal_probes);
+    if (IDA_KERNEL_IS_SOLVED(ida, &ida->state)) {
+      IDA_STAR_COUNT(ida, bound, goal_hits);
+      return FOUND;
+    }
+  }
+  size_t key = 0;
+  if (ida->table) {
+    key = IDA_KERNEL_HASH(ida, &ida->state);
+    unsigned char known = transposition_probe(ida->table, &ida->table_stats, key, so_far);
+    if (known != SKIP) {
+      return known;
+    }
+  }
+  IDA_STAR_COUNT(ida, bound, expanded);
+  unsigned char min = UNKNOWN;
+  LocDirCube parent = ida->state;
+  LocDirCube children[NUM_STABLE_MOVES];
+  LocDirCube inverses[NUM_STABLE_MOVES];
+  size_t fingerprints[NUM_STABLE_MOVES];
+  unsigned char estimates[NUM_STABLE_MOVES];
+  unsigned char order[NUM_STABLE_MOVES];
+  size_t num_children = 0;
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    if (!ida_star_try_push(ida, &parent, i)) {
+      continue;
+    }
+    children[i] = ida->state;
+    if (ida->track_inverse) {
+      inverses[i] = ida->inverse;
+    }
+    fingerprints[i] = ida->fingerprints[ida->num_moves];
+    estimates[i] = IDA_KERNEL_ESTIMATOR(ida, ida_star_limit(so_far + 1, bound));
+    ida_star_pop(ida, &parent);
+    unsigned char child_bound = so_far + 1 + estimates[i];
+    if (child_bound > bound) {
+      // Estimated here so counted as visited here
+      IDA_STAR_COUNT(ida, bound, visited);
+      IDA_STAR_COUNT(ida, bound, cutoffs);
+      if (child_bound < min) {
+        min = child_bound;
+      }
+      continue;
+    }
+    order[num_children++] = i;
+  }
+  ida_star_order_children(ida, order, num_children, estimates);
+  for (size_t k = 0; k < num_children; ++k) {
+    size_t i = order[k];
+    ida_star_push_child(ida, i, children + i, inverses + i, fingerprints[i]);
+    unsigned char child_result = IDA_KERNEL(ida_star_search_ordered)(ida, so_far + 1, bound, estimates[i]);
+    if (child_result == FOUND || child_result == ABORTED) {
+      return child_result;
+    }
+    ida_star_pop(ida, &parent);
+    if (child_result < min) {
+      min = child_result;
+      ida_star_reward(ida, i, bound - so_far);
+    }
+  }
+  if (ida->table) {
+    transposition_store(ida->table, &ida->table_stats, key, so_far, min);
+  }
+  return min;
+}
+
+// Runs a single iteration with the configured move ordering
+unsigned char IDA_KERNEL(ida_star_iterate)(IDAstar *ida, unsigned char so_far, unsigned char bound) {
+  if (ida->move_ordering) {
+    return IDA_KERNEL(ida_star_search_ordered)(ida, so_far, bound, IDA_KERNEL_ESTIMATOR(ida, ida_star_limit(so_far, bound)));
+  }
+  return IDA_KERNEL(ida_star_search)(ida, so_far, bound);
+}
+
+// Returns false if the budget of the search ran out first. The last bound in ida->bound is still a lower bound.
+bool IDA_KERNEL(ida_star_solve)(IDAstar *ida, LocDirCube *ldc, unsigned char lower_bound) {
+  ida_star_reset(ida, ldc);
+
+  unsigned char bound = IDA_KERNEL_ESTIMATOR(ida, UNKNOWN);
+
+  if (lower_bound > bound) {
+    bound = lower_bound;
+  }
+
+  for (;;) {
+    #if LOG_IDA_STAR_PROGRESS
+    printf("IDA* bound = %d\n", bound);
+    #endif
+    ida->bound = bound;
+    if (ida->budget && bound > ida->budget->max_bound) {
+      return false;
+    }
+    if (ida->table) {
+      ida->table->age++;
+    }
+    #if IDA_STAR_INSTRUMENTATION
+    double start = search_clock();
+    #endif
+    unsigned char search_result = IDA_KERNEL(ida_star_iterate)(ida, 0, bound);
+    #if IDA_STAR_INSTRUMENTATION
+    IDA_STAR_COUNT(ida, bound, num_iterations);
+    IDA_STAR_BOUND_STATS(ida, bound)->seconds += search_clock() - start;
+    #endif
+    if (search_result == FOUND) {
+      // Solution is stored in ida->moves.
+      return true;
+    }
+    if (search_result == ABORTED) {
+      return false;
+    }
+    bound = search_result;
+  }
+}
+
+bool IDA_KERNEL(ida_star_solve_parallel)(IDAstar *ida, LocDirCube *ldc, unsigned char lower_bound) {
+  ida_star_reset(ida, ldc);
+  ida->bound = 0;
+  // Check if already solved
+  if (IDA_KERNEL_IS_SOLVED(ida, ldc)) {
+    return true;
+  }
+
+  unsigned char bound = IDA_KERNEL_ESTIMATOR(ida, UNKNOWN);
+
+  if (lower_bound > bound) {
+    bound = lower_bound;
+  }
+
+  IDAstar ida_team[NUM_STABLE_MOVES * NUM_STABLE_MOVES];
+  LocDirCube children[NUM_STABLE_MOVES];
+  for (int i = 0; i < NUM_STABLE_MOVES; ++i) {
+    children[i] = *ldc;
+    locdir_apply_stable(children + i, STABLE_MOVES[i]);
+    for (int j = 0; j < NUM_STABLE_MOVES; ++j) {
+      int idx = i * NUM_STABLE_MOVES + j;
+      ida_team[idx] = *ida;
+      ida_star_clear_stats(ida_team + idx);
+      ida_star_push(ida_team + idx, i);
+      ida_star_push(ida_team + idx, j);
+    }
+  }
+
+  // Check if the first move already solves
+  for (int i = 0; i < NUM_STABLE_MOVES; ++i) {
+    if (IDA_KERNEL_IS_SOLVED(ida, children + i)) {
+      ida_star_push(ida, i);
+      ida->bound = 1;
+      return true;
+    }
+  }
+  // Check if the second move already solves
+  for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
+    if (IDA_KERNEL_IS_SOLVED(ida, &ida_team[i].state)) {
+      *ida = ida_team[i];
+      ida->bound = 2;
+      return true;
+    }
+  }
+
+  unsigned char team_results[NUM_STABLE_MOVES * NUM_STABLE_MOVES] = {0};
+  size_t num_members = 0;
+  for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
+    LocDirCube *child = children + ida_team[i].moves[0];
+    // Skip backtracking
+    if (
+      locdir_equals(ldc, child) ||
+      locdir_equals(ldc, &ida_team[i].state) ||
+      locdir_equals(child, &ida_team[i].state)
+    ) {
+      // printf("%d = (%d, %d) backtracks\n", i, i % NUM_STABLE_MOVES, i / NUM_STABLE_MOVES);
+      team_results[i] = SKIP;
+      continue;
+    }
+    // Skip duplicates
+    for (int j = 0; j < i; ++j) {
+      if (team_results[j] == SKIP) {
+        continue;
+      }
+      if (
+        locdir_equals(&ida_team[i].state, children + ida_team[j].moves[0]) ||
+        locdir_equals(&ida_team[i].state, &ida_team[j].state)
+      ) {
+        // printf("%d = (%d, %d) is a duplicate\n", i, i % NUM_STABLE_MOVES, i / NUM_STABLE_MOVES);
+        team_results[i] = SKIP;
+        break;
+      }
+    }
+    if (team_results[i] != SKIP) {
+      num_members++;
+    }
+  }
+
+  #if LOG_IDA_STAR_PROGRESS
+  printf("%zu members in IDA* team\n", num_members);
+  #endif
+
+
+  for (;;) {
+    #if LOG_IDA_STAR_PROGRESS
+    printf("IDA* bound = %d\n", bound);
+    #endif
+    ida->bound = bound;
+    if (ida->budget && bound > ida->budget->max_bound) {
+      return false;
+    }
+    bool found = false;
+    if (ida->table) {
+      ida->table->age++;
+    }
+    #if IDA_STAR_INSTRUMENTATION
+    double start = search_clock();
+    #endif
+    CancelToken *token = SEARCH_CANCEL_TOKEN;
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
+      if (team_results[i] == SKIP || found) {
+        continue;
+      }
+      SEARCH_CANCEL_TOKEN = token;
+      team_results[i] = IDA_KERNEL(ida_star_iterate)(ida_team + i, 2, bound);
+      if (team_results[i] == FOUND) {
+        found = true;
+      }
+    }
+
+    #if IDA_STAR_INSTRUMENTATION
+    // The members count the nodes and the team leader the time
+    IDA_STAR_COUNT(ida, bound, num_iterations);
+    IDA_STAR_BOUND_STATS(ida, bound)->seconds += search_clock() - start;
+    #endif
+    bound = UNKNOWN;
+    bool aborted = false;
+    for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
+      if (team_results[i] == SKIP) {
+        continue;
+      }
+      if (team_results[i] == FOUND) {
+        // Store result in ida->moves
+        for (int j = 0; j < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++j) {
+          if (j != i) {
+            ida_star_merge_stats(ida_team + i, ida_team + j);
+          }
+        }
+        ida_star_merge_stats(ida_team + i, ida);
+        ida_team[i].last_check = ida_team[i].num_nodes;
+        ida_team[i].bound = ida->bound;
+        *ida = ida_team[i];
+        return true;
+      }
+      if (team_results[i] == ABORTED) {
+        aborted = true;
+        continue;
+      }
+      bound = team_results[i] < bound ? team_results[i] : bound;
+    }
+    if (aborted) {
+      for (int i = 0; i < NUM_STABLE_MOVES * NUM_STABLE_MOVES; ++i) {
+        ida_star_merge_stats(ida, ida_team + i);
+      }
+      ida->last_check = ida->num_nodes;
+      return false;
+    }
+  }
+}
+
+// Returns NULL if there are no solutions within the bound or if the search was interrupted
+collection IDA_KERNEL(ida_star_search_all_stable)(IDAstar *ida, unsigned char so_far, unsigned char bound) {
+  if (ida->num_nodes - ida->last_check >= IDA_STAR_CHECK_INTERVAL && ida_star_interrupted(ida)) {
+    return NULL;
+  }
+  unsigned char to_go = IDA_KERNEL_ESTIMATOR(ida, ida_star_limit(so_far, bound));
+  unsigned char lower_bound = so_far + to_go;
+  if (lower_bound > bound) {
+    return NULL;
+  }
+  if (to_go == 0 && IDA_KERNEL_IS_SOLVED(ida, &ida->state)) {
+    collection result = malloc(2 * sizeof(sequence));
+    result[0] = I;
+    result[1] = SENTINEL;
+    return result;
+  }
+  int min = UNKNOWN;
+  collection child_results[NUM_STABLE_MOVES];
+  size_t num_child_results = 0;
+  LocDirCube parent = ida->state;
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    if (!ida_star_try_push(ida, &parent, i)) {
+      continue;
+    }
+
+    collection child_result = IDA_KERNEL(ida_star_search_all_stable)(ida, so_far + 1, bound);
+    if (ida_star_stopped(ida)) {
+      free(child_result);
+      for (size_t k = 0; k < num_child_results; ++k) {
+        free(child_results[k]);
+      }
+      return NULL;
+    }
+    if (child_result != NULL) {
+      int child_length = sequence_length(child_result[0]);
+      if (child_length > min) {
+        free(child_result);
+      }
+      if (child_length < min) {
+        min = child_length;
+        for (size_t k = 0; k < num_child_results; ++k) {
+          free(child_results[k]);
+        }
+        num_child_results = 0;
+      }
+      if (child_length <= min) {
+        collection it = child_result;
+        while (*it != SENTINEL) {
+          *it = concat(STABLE_MOVES[i], *it);
+          it++;
+        }
+        child_results[num_child_results++] = child_result;
+      }
+    }
+
+    ida_star_pop(ida, &parent);
+  }
+
+  size_t num_solutions = 0;
+  for (size_t i = 0; i < num_child_results; ++i) {
+    num_solutions += collection_size(child_results[i]);
+  }
+
+  collection result = malloc((num_solutions+1) * sizeof(sequence));
+  num_solutions = 0;
+
+  for (size_t i = 0; i < num_child_results; ++i) {
+    collection it = child_results[i];
+    while (*it != SENTINEL) {
+      result[num_solutions++] = *it;
+      it++;
+    }
+    free(child_results[i]);
+  }
+  result[num_solutions] = SENTINEL;
+
+  return result;
+}
+
+// Returns NULL if the search was interrupted
+collection IDA_KERNEL(ida_star_solve_all_stable)(IDAstar *ida, LocDirCube *ldc, unsigned char lower_bound) {
+  // Obtain the correct bound iteratively
+  if (!IDA_KERNEL(ida_star_solve)(ida, ldc, lower_bound)) {
+    return NULL;
+  }
+
+  unsigned char bound = ida->num_moves;
+  ida_star_reset(ida, ldc);
+  return IDA_KERNEL(ida_star_search_all_stable)(ida, 0, bound);
+}
+
+#undef IDA_KERNEL
+#undef IDA_KERNEL_ESTIMATOR
+#undef IDA_KERNEL_IS_SOLVED
+#undef IDA_KERNEL_HASH
@@ -107,6 +107,58 @@ bool locdir_equals(LocDirCube *a, LocDirCube *b) {
   return true;
 }
 
+// Composes two full cubes as permutations: The result is the state reached by applying the moves of first and then the moves of second.
+// Corner twists and edge flips are tied to locations, so they add up.
+void locdir_multiply(LocDirCube *result, LocDirCube *first, LocDirCube *second) {
+  for (int i = 0; i < 8; ++i) {
+    int loc = first->corner_locs[i];
+    result->corner_locs[i] = second->corner_locs[loc];
+    result->corner_dirs[i] = (first->corner_dirs[i] + second->corner_dirs[loc]) % 3;
+  }
+  for (int i = 0; i < 12; ++i) {
+    int loc = first->edge_locs[i];
+    result->edge_locs[i] = second->edge_locs[loc];
+    result->edge_dirs[i] = first->edge_dirs[i] == second->edge_dirs[loc];
+  }
+  for (int i = 0; i < 6; ++i) {
+    result->center_locs[i] = second->center_locs[(int)first->center_locs[i]];
+  }
+}
+
+// The inverse of a full cube, i.e. the state that the inverted scramble produces
+void locdir_invert(LocDirCube *result, LocDirCube *ldc) {
+  for (int i = 0; i < 8; ++i) {
+    int loc = ldc->corner_locs[i];
+    result->corner_locs[loc] = i;
+    result->corner_dirs[loc] = (3 - ldc->corner_dirs[i]) % 3;
+  }
+  for (int i = 0; i < 12; ++i) {
+    int loc = ldc->edge_locs[i];
+    result->edge_locs[loc] = i;
+    result->edge_dirs[loc] = ldc->edge_dirs[i];
+  }
+  for (int i = 0; i < 6; ++i) {
+    result->center_locs[(int)ldc->center_locs[i]] = i;
+  }
+}
+
+// Cheap hash of the full state. Equal cubes have equal fingerprints but not necessarily vice versa.
+size_t locdir_fingerprint(LocDirCube *ldc) {
+  size_t corners = 0;
+  for (int i = 0; i < 8; ++i) {
+    corners = (corners << 6) | ((ldc->corner_locs[i] & 15) << 2) | (ldc->corner_dirs[i] & 3);
+  }
+  size_t edges = 0;
+  for (int i = 0; i < 12; ++i) {
+    edges = (edges << 5) | ((ldc->edge_locs[i] & 15) << 1) | ldc->edge_dirs[i];
+  }
+  for (int i = 0; i < 6; ++i) {
+    corners = (corners << 3) ^ (ldc->center_locs[i] & 7);
+  }
+  size_t result = corners * 0x9E3779B97F4A7C15ULL ^ edges * 0xC2B2AE3D27D4EB4FULL;
+  return result ^ (result >> 29);
+}
+
 bool locdir_edges_solved(LocDirCube *ldc) {
   for (int i = 0; i < 12; ++i) {
     if (ldc->edge_locs[i] != i) {
@@ -140,6 +192,53 @@ bool locdir_solved(LocDirCube *ldc) {
   return locdir_centerless_solved(ldc);
 }
 
+// Parity of a permutation of 0, 1, ..., n - 1 or -1 if the array is not a permutation
+int permutation_parity(char *locs, int n) {
+  bool seen[12] = {false};
+  int parity = 0;
+  for (int i = 0; i < n; ++i) {
+    if (locs[i] < 0 || locs[i] >= n || seen[(int)locs[i]]) {
+      return -1;
+    }
+    seen[(int)locs[i]] = true;
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = i + 1; j < n; ++j) {
+      parity ^= locs[i] > locs[j];
+    }
+  }
+  return parity;
+}
+
+/* Check that the cube is in range and reachable from the solved state with the centers in the standard position. */
+bool locdir_is_solvable(LocDirCube *ldc) {
+  for (int i = 0; i < 6; ++i) {
+    if (ldc->center_locs[i] != i) {
+      return false;
+    }
+  }
+  int twist = 0;
+  for (int i = 0; i < 8; ++i) {
+    if (ldc->corner_dirs[i] < 0 || ldc->corner_dirs[i] > 2) {
+      return false;
+    }
+    twist += ldc->corner_dirs[i];
+  }
+  if (twist % 3) {
+    return false;
+  }
+  int flips = 0;
+  for (int i = 0; i < 12; ++i) {
+    flips += !ldc->edge_dirs[i];
+  }
+  if (flips % 2) {
+    return false;
+  }
+  int corner_parity = permutation_parity(ldc->corner_locs, 8);
+  int edge_parity = permutation_parity(ldc->edge_locs, 12);
+  return corner_parity >= 0 && corner_parity == edge_parity;
+}
+
 bool locdir_cross_solved(LocDirCube *ldc) {
   for (int i = 8; i < 12; ++i) {
     if (ldc->edge_locs[i] != i) {
@@ -204,6 +303,54 @@ size_t locdir_corner_index(LocDirCube *ldc) {
 
 const size_t LOCDIR_CORNER_INDEX_SPACE = 8*7*6*5*4*3*2*1 * 3*3*3*3 * 3*3*3*(1);
 
+// Small coordinates for pre-filtering. The orientations are indexed by location which makes them independent of the permutation.
+
+size_t locdir_corner_permutation_index(LocDirCube *ldc) {
+  size_t result = 0;
+  for (int i = 0; i < 7; ++i) {
+    char loc = ldc->corner_locs[i];
+    for (int j = i - 1; j >= 0; --j) {
+      if (ldc->corner_locs[j] < ldc->corner_locs[i]) {
+        loc--;
+      }
+    }
+    result = loc + result * (8 - i);
+  }
+  return result;
+}
+
+const size_t LOCDIR_CORNER_PERMUTATION_INDEX_SPACE = 8*7*6*5*4*3*2*1;
+
+size_t locdir_corner_orientation_index(LocDirCube *ldc) {
+  char dirs[8];
+  for (int i = 0; i < 8; ++i) {
+    dirs[(int)ldc->corner_locs[i]] = ldc->corner_dirs[i];
+  }
+  // The last one is determined by the rest
+  size_t result = 0;
+  for (int i = 0; i < 7; ++i) {
+    result = dirs[i] + 3 * result;
+  }
+  return result;
+}
+
+const size_t LOCDIR_CORNER_ORIENTATION_INDEX_SPACE = 3*3*3*3 * 3*3*3*(1);
+
+size_t locdir_edge_orientation_index(LocDirCube *ldc) {
+  bool dirs[12];
+  for (int i = 0; i < 12; ++i) {
+    dirs[(int)ldc->edge_locs[i]] = ldc->edge_dirs[i];
+  }
+  // The last one is determined by the rest
+  size_t result = 0;
+  for (int i = 0; i < 11; ++i) {
+    result = dirs[i] + 2 * result;
+  }
+  return result;
+}
+
+const size_t LOCDIR_EDGE_ORIENTATION_INDEX_SPACE = 2*2*2*2 * 2*2*2*2 * 2*2*2*(1);
+
 size_t locdir_four_corner_index(LocDirCube *ldc) {
   size_t result = 0;
   for (int i = 0; i < 4; ++i) {
@@ -321,6 +468,146 @@ const size_t LOCDIR_FIRST_4_EDGE_INDEX_SPACE = 12*11*10*9 * 2*2*2*2;
 const size_t LOCDIR_MIDDLE_4_EDGE_INDEX_SPACE = LOCDIR_FIRST_4_EDGE_INDEX_SPACE;
 const size_t LOCDIR_LAST_4_EDGE_INDEX_SPACE = LOCDIR_FIRST_4_EDGE_INDEX_SPACE;
 
+/*
+Coordinates for two-phase solving through the domino subgroup <U, D, R2, L2, F2, B2> (E2, M2 and S2 included).
+The offsets convert the orientations into the usual convention where the subgroup leaves every cubie at zero.
+*/
+const char LOCDIR_DOMINO_TWIST_OFFSETS[8] = {0, 0, 0, 0, 2, 2, 2, 2};
+const char LOCDIR_DOMINO_FLIP_OFFSETS[12] = {0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0};
+
+size_t locdir_domino_twist_index(LocDirCube *ldc) {
+  char twists[8];
+  for (int i = 0; i < 8; ++i) {
+    int loc = ldc->corner_locs[i];
+    twists[loc] = (ldc->corner_dirs[i] + LOCDIR_DOMINO_TWIST_OFFSETS[i] + 3 - LOCDIR_DOMINO_TWIST_OFFSETS[loc]) % 3;
+  }
+  // The last one is determined by the rest
+  size_t result = 0;
+  for (int i = 0; i < 7; ++i) {
+    result = twists[i] + 3 * result;
+  }
+  return result;
+}
+
+size_t locdir_domino_flip_index(LocDirCube *ldc) {
+  char flips[12];
+  for (int i = 0; i < 12; ++i) {
+    int loc = ldc->edge_locs[i];
+    flips[loc] = !ldc->edge_dirs[i] ^ LOCDIR_DOMINO_FLIP_OFFSETS[i] ^ LOCDIR_DOMINO_FLIP_OFFSETS[loc];
+  }
+  // The last one is determined by the rest
+  size_t result = 0;
+  for (int i = 0; i < 11; ++i) {
+    result = flips[i] + 2 * result;
+  }
+  return result;
+}
+
+// Which 4 of the 12 locations hold the E slice edges 4, 5, 6 and 7 in the combinatorial number system
+size_t locdir_domino_slice_index(LocDirCube *ldc) {
+  bool occupied[12] = {false};
+  for (int i = 4; i < 8; ++i) {
+    occupied[(int)ldc->edge_locs[i]] = true;
+  }
+  size_t result = 0;
+  size_t k = 0;
+  // Running binomial coefficient (loc choose k)
+  for (int loc = 0; loc < 12; ++loc) {
+    if (occupied[loc]) {
+      k++;
+      size_t binomial = 1;
+      for (size_t j = 0; j < k; ++j) {
+        binomial = binomial * (loc - j) / (j + 1);
+      }
+      result += binomial;
+    }
+  }
+  return result;
+}
+
+// Permutation of the U and D layer edges. Only meaningful inside the domino subgroup.
+size_t locdir_domino_edge_permutation_index(LocDirCube *ldc) {
+  // Close the gap left by the E slice locations
+  char locs[8];
+  for (int i = 0; i < 4; ++i) {
+    locs[i] = ldc->edge_locs[i] < 4 ? ldc->edge_locs[i] : ldc->edge_locs[i] - 4;
+    locs[4 + i] = ldc->edge_locs[8 + i] < 4 ? ldc->edge_locs[8 + i] : ldc->edge_locs[8 + i] - 4;
+  }
+  size_t result = 0;
+  for (int i = 0; i < 7; ++i) {
+    char loc = locs[i];
+    for (int j = i - 1; j >= 0; --j) {
+      if (locs[j] < locs[i]) {
+        loc--;
+      }
+    }
+    result = loc + result * (8 - i);
+  }
+  return result;
+}
+
+// Permutation of the E slice edges. Only meaningful inside the domino subgroup.
+size_t locdir_domino_slice_permutation_index(LocDirCube *ldc) {
+  size_t result = 0;
+  for (int i = 0; i < 3; ++i) {
+    char loc = ldc->edge_locs[4 + i] - 4;
+    for (int j = i - 1; j >= 0; --j) {
+      if (ldc->edge_locs[4 + j] < ldc->edge_locs[4 + i]) {
+        loc--;
+      }
+    }
+    result = loc + result * (4 - i);
+  }
+  return result;
+}
+
+const size_t LOCDIR_DOMINO_TWIST_INDEX_SPACE = 3*3*3*3 * 3*3*3*(1);
+const size_t LOCDIR_DOMINO_FLIP_INDEX_SPACE = 2*2*2*2 * 2*2*2*2 * 2*2*2*(1);
+const size_t LOCDIR_DOMINO_SLICE_INDEX_SPACE = 495;
+const size_t LOCDIR_DOMINO_EDGE_PERMUTATION_INDEX_SPACE = 8*7*6*5*4*3*2*1;
+const size_t LOCDIR_DOMINO_SLICE_PERMUTATION_INDEX_SPACE = 4*3*2*1;
+
+size_t locdir_domino_twist_slice_index(LocDirCube *ldc) {
+  return locdir_domino_twist_index(ldc) * LOCDIR_DOMINO_SLICE_INDEX_SPACE + locdir_domino_slice_index(ldc);
+}
+
+size_t locdir_domino_flip_slice_index(LocDirCube *ldc) {
+  return locdir_domino_flip_index(ldc) * LOCDIR_DOMINO_SLICE_INDEX_SPACE + locdir_domino_slice_index(ldc);
+}
+
+size_t locdir_domino_corner_slice_index(LocDirCube *ldc) {
+  return locdir_corner_permutation_index(ldc) * LOCDIR_DOMINO_SLICE_PERMUTATION_INDEX_SPACE + locdir_domino_slice_permutation_index(ldc);
+}
+
+size_t locdir_domino_edge_slice_index(LocDirCube *ldc) {
+  return locdir_domino_edge_permutation_index(ldc) * LOCDIR_DOMINO_SLICE_PERMUTATION_INDEX_SPACE + locdir_domino_slice_permutation_index(ldc);
+}
+
+const size_t LOCDIR_DOMINO_TWIST_SLICE_INDEX_SPACE = 3*3*3*3 * 3*3*3 * 495;
+const size_t LOCDIR_DOMINO_FLIP_SLICE_INDEX_SPACE = 2*2*2*2 * 2*2*2*2 * 2*2*2 * 495;
+const size_t LOCDIR_DOMINO_CORNER_SLICE_INDEX_SPACE = 8*7*6*5*4*3*2*1 * 4*3*2*1;
+const size_t LOCDIR_DOMINO_EDGE_SLICE_INDEX_SPACE = 8*7*6*5*4*3*2*1 * 4*3*2*1;
+
+// In the domino subgroup exactly when the twist, flip and slice coordinates are solved
+bool locdir_domino_solved(LocDirCube *ldc) {
+  for (int i = 0; i < 8; ++i) {
+    int loc = ldc->corner_locs[i];
+    if ((ldc->corner_dirs[i] + LOCDIR_DOMINO_TWIST_OFFSETS[i] + 3 - LOCDIR_DOMINO_TWIST_OFFSETS[loc]) % 3) {
+      return false;
+    }
+  }
+  for (int i = 0; i < 12; ++i) {
+    int loc = ldc->edge_locs[i];
+    if (!ldc->edge_dirs[i] ^ LOCDIR_DOMINO_FLIP_OFFSETS[i] ^ LOCDIR_DOMINO_FLIP_OFFSETS[loc]) {
+      return false;
+    }
+    if ((i >= 4 && i < 8) != (loc >= 4 && loc < 8)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 /* Index for an intermediary stage in OLL solving. */
 size_t locdir_oll_index(LocDirCube *ldc) {
   size_t result = 0;
@@ -468,6 +755,28 @@ size_t locdir_centerless_hash(LocDirCube *ldc) {
   return result;
 }
 
+// Exact version of the above. It needs 66 bits.
+unsigned __int128 locdir_centerless_rank(LocDirCube *ldc) {
+  unsigned __int128 result = locdir_corner_index(ldc);
+  for (int i = 0; i < 10; ++i) {
+    char loc = ldc->edge_locs[i];
+    for (int j = i - 1; j >= 0; --j) {
+      if (ldc->edge_locs[j] < ldc->edge_locs[i]) {
+        loc--;
+      }
+    }
+    result = loc + result * (12 - i);
+    result = ldc->edge_dirs[i] + 2 * result;
+  }
+  result = ldc->edge_dirs[10] + 2 * result;
+  return result;
+}
+
+// The bits of the centerless rank that overflow locdir_centerless_hash. Together they identify the position.
+unsigned char locdir_centerless_tag(LocDirCube *ldc) {
+  return locdir_centerless_rank(ldc) >> 64;
+}
+
 bitboard corner_to_bitboard(char loc, char dir) {
   dir %= 3;
 
@@ -1670,6 +1979,24 @@ void locdir_apply_stable_sequence(LocDirCube *ldc, sequence seq) {
   }
 }
 
+/* Apply moves in standard notation one at a time so that the length is not limited to SEQUENCE_MAX_LENGTH. */
+void locdir_apply_string(LocDirCube *ldc, char *string) {
+  while (string[0] != '\0') {
+    if (string[0] == ' ' || string[0] == '\t' || string[0] == '\n' || string[0] == '\r' || string[0] == '[' || string[0] == ']') {
+      string++;
+    } else if (string[1] == '\'') {
+      locdir_apply(ldc, parse_prime(string[0]));
+      string += 2;
+    } else if (string[1] == '2') {
+      locdir_apply(ldc, parse_double(string[0]));
+      string += 2;
+    } else {
+      locdir_apply(ldc, parse_move(string[0]));
+      string++;
+    }
+  }
+}
+
 /* Rotate the cube so that the centers are in the standard position. */
 void locdir_realign(LocDirCube *ldc) {
   // Move white to the bottom
@@ -1716,9 +2043,365 @@ void locdir_realign(LocDirCube *ldc) {
   }
 }
 
-void locdir_scramble(LocDirCube *ldc) {
+/* Center orientations */
+
+#define NUM_ORIENTATIONS (24)
+
+typedef struct {
+  enum move move;
+  unsigned char orientation;
+} OrientedMove;
+
+// Whole-cube rotations of the solved cube. Index 0 is the standard orientation.
+LocDirCube LOCDIR_ORIENTATIONS[NUM_ORIENTATIONS];
+LocDirCube LOCDIR_INVERSE_ORIENTATIONS[NUM_ORIENTATIONS];
+
+// Indexed by 6 * (location of the white center) + (location of the green center)
+unsigned char LOCDIR_ORIENTATION_INDEX[6 * 6];
+
+// Applying a move to a cube with the given center orientation and realigning is the same as
+// applying the stable move to the realigned cube. The centers end up in the new orientation.
+OrientedMove LOCDIR_ORIENTED_MOVES[NUM_ORIENTATIONS][NUM_MOVES];
+
+#define MAX_STABLE_EXPANSION (2)
+
+typedef struct {
+  unsigned char num_moves;
+  unsigned char moves[MAX_STABLE_EXPANSION];
+  unsigned char orientations[MAX_STABLE_EXPANSION];
+} StableExpansion;
+
+// Index of the inverse of each stable move in STABLE_MOVES
+unsigned char STABLE_MOVE_INVERSES[NUM_STABLE_MOVES];
+
+// Each stable move applied to the solved cube for use with locdir_multiply
+LocDirCube STABLE_MOVE_CUBES[NUM_STABLE_MOVES];
+
+// The inverse of the above: All the moves (in priority order) that realign to a given stable move.
+StableExpansion LOCDIR_STABLE_EXPANSIONS[NUM_ORIENTATIONS][NUM_MOVES];
+
+// Each move conjugated by each orientation as in locdir_conjugate
+enum move LOCDIR_MOVE_CONJUGATES[NUM_ORIENTATIONS][NUM_MOVES];
+
+// Index of the inverse of each orientation in LOCDIR_ORIENTATIONS
+unsigned char LOCDIR_INVERSE_ORIENTATION_INDEX[NUM_ORIENTATIONS];
+
+bool LOCDIR_ORIENTATIONS_READY = false;
+
+unsigned char locdir_orientation(LocDirCube *ldc) {
+  return LOCDIR_ORIENTATION_INDEX[6 * ldc->center_locs[5] + ldc->center_locs[1]];
+}
+
+void prepare_locdir_orientations() {
+  if (LOCDIR_ORIENTATIONS_READY) {
+    return;
+  }
+
+  // Close the standard orientation under x and y
+  size_t num_orientations = 1;
+  locdir_reset(LOCDIR_ORIENTATIONS);
+  for (size_t i = 0; i < num_orientations; ++i) {
+    LocDirCube children[2] = {LOCDIR_ORIENTATIONS[i], LOCDIR_ORIENTATIONS[i]};
+    locdir_x(children);
+    locdir_y(children + 1);
+    for (size_t j = 0; j < 2; ++j) {
+      bool seen = false;
+      for (size_t k = 0; k < num_orientations; ++k) {
+        if (locdir_equals(children + j, LOCDIR_ORIENTATIONS + k)) {
+          seen = true;
+          break;
+        }
+      }
+      if (!seen) {
+        LOCDIR_ORIENTATIONS[num_orientations++] = children[j];
+      }
+    }
+  }
+  if (num_orientations != NUM_ORIENTATIONS) {
+    fprintf(stderr, "Unexpected number of center orientations\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < NUM_ORIENTATIONS; ++i) {
+    locdir_invert(LOCDIR_INVERSE_ORIENTATIONS + i, LOCDIR_ORIENTATIONS + i);
+  }
+  for (size_t i = 0; i < NUM_ORIENTATIONS; ++i) {
+    LocDirCube *rotated = LOCDIR_ORIENTATIONS + i;
+    LOCDIR_ORIENTATION_INDEX[6 * rotated->center_locs[5] + rotated->center_locs[1]] = i;
+  }
+
+  // The realigned result of a move only depends on the orientation so the solved cube works as a probe
+  LocDirCube solved;
+  locdir_reset(&solved);
+  for (size_t i = 0; i < NUM_ORIENTATIONS; ++i) {
+    for (enum move move = I; move <= MAX_MOVE; ++move) {
+      LocDirCube child = LOCDIR_ORIENTATIONS[i];
+      locdir_apply(&child, move);
+      LOCDIR_ORIENTED_MOVES[i][move].orientation = locdir_orientation(&child);
+      locdir_realign(&child);
+      if (locdir_equals(&child, &solved)) {
+        LOCDIR_ORIENTED_MOVES[i][move].move = I;
+        continue;
+      }
+      bool found = false;
+      for (size_t j = 0; j < NUM_STABLE_MOVES; ++j) {
+        LocDirCube stable = solved;
+        locdir_apply_stable(&stable, STABLE_MOVES[j]);
+        if (locdir_equals(&child, &stable)) {
+          LOCDIR_ORIENTED_MOVES[i][move].move = STABLE_MOVES[j];
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        fprintf(stderr, "No stable equivalent for %s\n", move_to_string(move));
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < NUM_ORIENTATIONS; ++i) {
+    for (enum move move = I; move <= MAX_MOVE; ++move) {
+      LOCDIR_STABLE_EXPANSIONS[i][move].num_moves = 0;
+    }
+    for (enum move move = U; move <= MAX_MOVE; ++move) {
+      OrientedMove oriented = LOCDIR_ORIENTED_MOVES[i][move];
+      StableExpansion *expansion = &LOCDIR_STABLE_EXPANSIONS[i][oriented.move];
+      if (expansion->num_moves >= MAX_STABLE_EXPANSION) {
+        fprintf(stderr, "Too many moves equivalent to %s\n", move_to_string(oriented.move));
+        exit(EXIT_FAILURE);
+      }
+      expansion->moves[expansion->num_moves] = move;
+      expansion->orientations[expansion->num_moves] = oriented.orientation;
+      expansion->num_moves++;
+    }
+  }
+
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    STABLE_MOVE_CUBES[i] = solved;
+    locdir_apply_stable(STABLE_MOVE_CUBES + i, STABLE_MOVES[i]);
+    bool found = false;
+    for (size_t j = 0; j < NUM_STABLE_MOVES; ++j) {
+      LocDirCube undone = solved;
+      locdir_apply_stable(&undone, STABLE_MOVES[i]);
+      locdir_apply_stable(&undone, STABLE_MOVES[j]);
+      if (locdir_equals(&undone, &solved)) {
+        STABLE_MOVE_INVERSES[i] = j;
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      fprintf(stderr, "No stable inverse for %s\n", move_to_string(STABLE_MOVES[i]));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for (size_t i = 0; i < NUM_ORIENTATIONS; ++i) {
+    LOCDIR_INVERSE_ORIENTATION_INDEX[i] = locdir_orientation(LOCDIR_INVERSE_ORIENTATIONS + i);
+    for (enum move move = I; move <= MAX_MOVE; ++move) {
+      LocDirCube moved = solved;
+      locdir_apply(&moved, move);
+      LocDirCube rotated;
+      LocDirCube conjugate;
+      locdir_multiply(&rotated, LOCDIR_ORIENTATIONS + i, &moved);
+      locdir_multiply(&conjugate, &rotated, LOCDIR_INVERSE_ORIENTATIONS + i);
+      bool found = false;
+      for (enum move other = I; other <= MAX_MOVE; ++other) {
+        LocDirCube candidate = solved;
+        locdir_apply(&candidate, other);
+        if (locdir_equals(&candidate, &conjugate)) {
+          LOCDIR_MOVE_CONJUGATES[i][move] = other;
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        fprintf(stderr, "No conjugate for %s\n", move_to_string(move));
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  LOCDIR_ORIENTATIONS_READY = true;
+}
+
+// Conjugates a full cube by one of the whole-cube rotations in LOCDIR_ORIENTATIONS (I, x, y, x2, ...).
+// The stable moves are symmetric, so the result is exactly as far from solved as the original.
+void locdir_conjugate(LocDirCube *result, LocDirCube *ldc, size_t orientation) {
+  LocDirCube rotated;
+  locdir_multiply(&rotated, LOCDIR_ORIENTATIONS + orientation, ldc);
+  locdir_multiply(result, &rotated, LOCDIR_INVERSE_ORIENTATIONS + orientation);
+}
+
+// Conjugates every move of the sequence so that it does to locdir_conjugate(ldc, orientation) what the original does to ldc
+sequence locdir_conjugate_sequence(sequence seq, size_t orientation) {
+  if (seq == INVALID) {
+    return INVALID;
+  }
+  sequence result = 0;
+  sequence place = 1;
+  for (int i = 0; i < SEQUENCE_MAX_LENGTH; ++i) {
+    result += place * LOCDIR_MOVE_CONJUGATES[orientation][seq % NUM_MOVES];
+    place *= NUM_MOVES;
+    seq /= NUM_MOVES;
+  }
+  return result;
+}
+
+/*
+Solution for the inverse of a cube given a solution of the cube itself.
+The solution may leave the cube rotated so its inverse has to be conjugated by that rotation.
+*/
+sequence locdir_invert_solution(LocDirCube *ldc, sequence solution) {
+  LocDirCube solved = *ldc;
+  locdir_apply_sequence(&solved, solution);
+  return locdir_conjugate_sequence(invert(solution), locdir_orientation(&solved));
+}
+
+// Inverse of the rank split between locdir_centerless_hash and locdir_centerless_tag
+void locdir_centerless_unrank(LocDirCube *ldc, size_t hash, unsigned char tag) {
+  unsigned __int128 rank = ((unsigned __int128) tag << 64) | hash;
+  locdir_reset(ldc);
+
+  ldc->edge_dirs[10] = rank % 2;
+  rank /= 2;
+  char edge_digits[10];
+  for (int i = 9; i >= 0; --i) {
+    ldc->edge_dirs[i] = rank % 2;
+    rank /= 2;
+    edge_digits[i] = rank % (12 - i);
+    rank /= 12 - i;
+  }
+  size_t corner_rank = rank;
+  char corner_digits[7];
+  for (int i = 6; i >= 0; --i) {
+    ldc->corner_dirs[i] = corner_rank % 3;
+    corner_rank /= 3;
+    corner_digits[i] = corner_rank % (8 - i);
+    corner_rank /= 8 - i;
+  }
+
+  // Each digit counts the free locations below the actual one
+  bool used[12] = {false};
+  int corner_twist = 0;
+  for (int i = 0; i < 8; ++i) {
+    int digit = (i < 7) ? corner_digits[i] : 0;
+    for (int loc = 0; loc < 8; ++loc) {
+      if (!used[loc] && digit-- == 0) {
+        ldc->corner_locs[i] = loc;
+        used[loc] = true;
+        break;
+      }
+    }
+    if (i < 7) {
+      corner_twist += ldc->corner_dirs[i];
+    }
+  }
+  ldc->corner_dirs[7] = (3 - corner_twist % 3) % 3;
+
+  for (int i = 0; i < 12; ++i) {
+    used[i] = false;
+  }
+  int num_flipped = 0;
+  for (int i = 0; i < 12; ++i) {
+    int digit = (i < 10) ? edge_digits[i] : 0;
+    for (int loc = 0; loc < 12; ++loc) {
+      if (!used[loc] && digit-- == 0) {
+        ldc->edge_locs[i] = loc;
+        used[loc] = true;
+        break;
+      }
+    }
+    if (i < 11 && !ldc->edge_dirs[i]) {
+      num_flipped++;
+    }
+  }
+  ldc->edge_dirs[11] = (num_flipped % 2 == 0);
+
+  // The last two edges are ordered to match the parity of the corners
+  int parity = 0;
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < i; ++j) {
+      parity += ldc->corner_locs[j] > ldc->corner_locs[i];
+    }
+  }
+  for (int i = 0; i < 12; ++i) {
+    for (int j = 0; j < i; ++j) {
+      parity += ldc->edge_locs[j] > ldc->edge_locs[i];
+    }
+  }
+  if (parity % 2) {
+    char loc = ldc->edge_locs[10];
+    ldc->edge_locs[10] = ldc->edge_locs[11];
+    ldc->edge_locs[11] = loc;
+  }
+}
+
+// Whole-cube rotations and inversion preserve the distance from solved because the stable moves are closed under both.
+// The representative of a position is its conjugate (optionally of its inverse) with the smallest centerless rank.
+/*
+Canonical representative that also reports the symmetry used.
+result = locdir_conjugate(inverted ? inverse of ldc : ldc, orientation)
+*/
+void locdir_centerless_canonical_with(LocDirCube *result, LocDirCube *ldc, bool with_inverse, size_t *orientation, bool *inverted) {
+  prepare_locdir_orientations();
+  *result = *ldc;
+  *orientation = 0;
+  *inverted = false;
+  unsigned __int128 best = locdir_centerless_rank(ldc);
+  LocDirCube inverse;
+  if (with_inverse) {
+    locdir_invert(&inverse, ldc);
+  }
+  for (size_t k = 0; k < (with_inverse ? 2 : 1); ++k) {
+    LocDirCube *source = k ? &inverse : ldc;
+    for (size_t i = k ? 0 : 1; i < NUM_ORIENTATIONS; ++i) {
+      LocDirCube conjugate;
+      locdir_conjugate(&conjugate, source, i);
+      unsigned __int128 rank = locdir_centerless_rank(&conjugate);
+      if (rank < best) {
+        best = rank;
+        *result = conjugate;
+        *orientation = i;
+        *inverted = k;
+      }
+    }
+  }
+}
+
+void locdir_centerless_canonical(LocDirCube *result, LocDirCube *ldc, bool with_inverse) {
+  size_t orientation;
+  bool inverted;
+  locdir_centerless_canonical_with(result, ldc, with_inverse, &orientation, &inverted);
+}
+
+size_t locdir_symmetric_hash(LocDirCube *ldc) {
+  LocDirCube canonical;
+  locdir_centerless_canonical(&canonical, ldc, false);
+  return locdir_centerless_hash(&canonical);
+}
+
+unsigned char locdir_symmetric_tag(LocDirCube *ldc) {
+  LocDirCube canonical;
+  locdir_centerless_canonical(&canonical, ldc, false);
+  return locdir_centerless_tag(&canonical);
+}
+
+size_t locdir_symmetric_inverse_hash(LocDirCube *ldc) {
+  LocDirCube canonical;
+  locdir_centerless_canonical(&canonical, ldc, true);
+  return locdir_centerless_hash(&canonical);
+}
+
+unsigned char locdir_symmetric_inverse_tag(LocDirCube *ldc) {
+  LocDirCube canonical;
+  locdir_centerless_canonical(&canonical, ldc, true);
+  return locdir_centerless_tag(&canonical);
+}
+
+void locdir_scramble(LocDirCube *ldc, Prng *prng) {
   for (int i = 0; i < 100; ++i) {
-    int r = rand() % 6;
+    int r = prng_below(prng, 6);
     switch(r) {
       case 0:
         locdir_U(ldc);
@@ -1835,47 +2518,63 @@ bool is_stable(sequence seq) {
   return true;
 }
 
-collection expand_stable_sequence_(sequence seq, LocDirCube *stable_, LocDirCube *unstable) {
+size_t count_stable_expansions(sequence seq, unsigned char orientation) {
   enum move stable_move = seq % NUM_MOVES;
-
-  collection results;
   if (!stable_move) {
-    results = malloc(2 * sizeof(sequence));
-    results[0] = I;
-    results[1] = SENTINEL;
-    return results;
+    return 1;
   }
+  seq /= NUM_MOVES;
 
+  StableExpansion *expansion = &LOCDIR_STABLE_EXPANSIONS[orientation][stable_move];
+  size_t result = 0;
+  for (size_t i = 0; i < expansion->num_moves; ++i) {
+    result += count_stable_expansions(seq, expansion->orientations[i]);
+  }
+  return result;
+}
+
+// Writes the expansions of a reversed stable sequence after the given prefix and returns the end of the output
+collection expand_stable_sequence_(sequence seq, unsigned char orientation, sequence prefix, collection output) {
+  enum move stable_move = seq % NUM_MOVES;
+  if (!stable_move) {
+    *output = prefix;
+    return output + 1;
+  }
   seq /= NUM_MOVES;
 
-  LocDirCube stable = *stable_;
-  locdir_apply_stable(&stable, stable_move);
-
-  results = malloc(sizeof(sequence));
-  results[0] = SENTINEL;
-  for (enum move move = U; move <= MAX_MOVE; ++move) {
-    LocDirCube child = *unstable;
-    locdir_apply(&child, move);
-    LocDirCube aligned = child;
-    locdir_realign(&aligned);
-    if (locdir_equals(&stable, &aligned)) {
-      collection variants = expand_stable_sequence_(seq, &stable, &child);
-      collection it = variants;
-      while (*it != SENTINEL) {
-        *it = concat(move, *it);
-        it++;
-      }
-      results = extend_collection(results, variants);
-      free(variants);
-    }
+  StableExpansion *expansion = &LOCDIR_STABLE_EXPANSIONS[orientation][stable_move];
+  for (size_t i = 0; i < expansion->num_moves; ++i) {
+    output = expand_stable_sequence_(seq, expansion->orientations[i], prefix * NUM_MOVES + expansion->moves[i], output);
   }
-  return results;
+  return output;
 }
 
 collection expand_stable_sequence(sequence seq) {
-  LocDirCube stable;
-  locdir_reset(&stable);
-  LocDirCube unstable = stable;
+  prepare_locdir_orientations();
 
-  return expand_stable_sequence_(reverse(seq), &stable, &unstable);
+  seq = reverse(seq);
+  size_t num_results = count_stable_expansions(seq, 0);
+  collection results = malloc((num_results + 1) * sizeof(sequence));
+  expand_stable_sequence_(seq, 0, I, results);
+  results[num_results] = SENTINEL;
+  return results;
+}
+
+// Only the first of the expansions without enumerating the rest
+sequence first_stable_expansion(sequence seq) {
+  if (seq == INVALID) {
+    return INVALID;
+  }
+  prepare_locdir_orientations();
+
+  seq = reverse(seq);
+  unsigned char orientation = 0;
+  sequence result = I;
+  for (enum move stable_move = seq % NUM_MOVES; stable_move; stable_move = seq % NUM_MOVES) {
+    StableExpansion *expansion = &LOCDIR_STABLE_EXPANSIONS[orientation][stable_move];
+    result = result * NUM_MOVES + expansion->moves[0];
+    orientation = expansion->orientations[0];
+    seq /= NUM_MOVES;
+  }
+  return result;
 }
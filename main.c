@@ -3,6 +3,7 @@
 #include "time.h"
 #include "stdbool.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
@@ -10,10 +11,11 @@
 #include "tablebase.c"
 #include "goalsphere.c"
 #include "ida_star.c"
+#include "solution_cache.c"
 #include "global_solver.c"
 
 
-void solve_2x2x2() {
+void solve_2x2x2(Prng *prng) {
   LocDirCube two_cubed;
 
   locdir_reset(&two_cubed);
@@ -23,7 +25,7 @@ void solve_2x2x2() {
   populate_nibblebase(&tablebase, &two_cubed);
 
   for (int i = 0; i < 20; ++i) {
-    locdir_scramble(&two_cubed);
+    locdir_scramble(&two_cubed, prng);
     print_sequence(nibble_solve(&tablebase, &two_cubed, &is_better));
     Cube cube = to_cube(&two_cubed);
     render(&cube);
@@ -33,16 +35,16 @@ void solve_2x2x2() {
   free_nibblebase(&tablebase);
 }
 
-void solve_3x3x3() {
+void solve_3x3x3(Prng *prng) {
   prepare_global_solver();
 
   LocDirCube ldc;
   printf("Solving a few easy scrambles...\n");
   for (size_t j = 0; j < 10; j++) {
-    // locdir_scramble(&ldc);
+    // locdir_scramble(&ldc, prng);
     locdir_reset(&ldc);
     for (size_t i = 0; i < 15; ++i) {
-      locdir_apply_stable(&ldc, STABLE_MOVES[rand() % NUM_STABLE_MOVES]);
+      locdir_apply_stable(&ldc, STABLE_MOVES[prng_below(prng, NUM_STABLE_MOVES)]);
     }
 
     Cube cube = to_cube(&ldc);
@@ -68,7 +70,7 @@ void solve_3x3x3() {
   size_t max_moves = 0;
   for (size_t i = 0; i < total_solves; ++i) {
     locdir_reset(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, prng);
 
     sequence solution = global_solve(&ldc);
     size_t num_moves = sequence_length(solution);
@@ -95,6 +97,54 @@ void solve_3x3x3() {
 }
 
 
+// Compares the number of IDA* nodes with different lookup configurations on a fixed set of scrambles
+void benchmark_estimators() {
+  prepare_global_solver();
+
+  size_t num_scrambles = 20;
+  LocDirCube *scrambles = malloc(num_scrambles * sizeof(LocDirCube));
+  Prng prng = init_prng(1);
+  for (size_t i = 0; i < num_scrambles; ++i) {
+    locdir_reset(scrambles + i);
+    for (size_t j = 0; j < 18; ++j) {
+      locdir_apply_stable(scrambles + i, STABLE_MOVES[prng_below(&prng, NUM_STABLE_MOVES)]);
+    }
+  }
+
+  size_t conjugation_counts[] = {1, 3, 6, 24};
+  for (size_t k = 0; k < sizeof(conjugation_counts) / sizeof(size_t); ++k) {
+    for (int track_inverse = 0; track_inverse <= 1; ++track_inverse) {
+      GLOBAL_SOLVER.num_conjugations = conjugation_counts[k];
+      GLOBAL_SOLVER.ida.track_inverse = track_inverse;
+      ida_star_clear_stats(&GLOBAL_SOLVER.ida);
+      size_t total_moves = 0;
+      clock_t start = clock();
+      for (size_t i = 0; i < num_scrambles; ++i) {
+        unsigned char goal_depth = goalsphere_depth(&GLOBAL_SOLVER.goal, scrambles + i, 0);
+        if (goal_depth != UNKNOWN) {
+          continue;
+        }
+        global_ida_star_solve(&GLOBAL_SOLVER.ida, scrambles + i, global_lower_bound(scrambles + i));
+        total_moves += GLOBAL_SOLVER.ida.num_moves;
+      }
+      double took = clock() - start;
+      took /= CLOCKS_PER_SEC;
+      printf(
+        "%s lookups with %zu conjugations: %zu nodes, %zu moves to the goal sphere in total, %g seconds\n",
+        track_inverse ? "Dual" : "Single",
+        conjugation_counts[k],
+        GLOBAL_SOLVER.ida.num_nodes,
+        total_moves,
+        took
+      );
+      fprint_global_stage_stats(stdout, &GLOBAL_SOLVER.ida);
+    }
+  }
+
+  free(scrambles);
+  free_global_solver();
+}
+
 void pll_solutions() {
   prepare_global_solver();
 
@@ -176,7 +226,8 @@ void pll_solutions() {
   free_global_solver();
 }
 
-void cross_stats() {
+// Every section sees the same cases so that the color neutral depths compare directly with the single color ones
+void cross_stats(uint64_t seed) {
   Nibblebase tablebase = init_nibblebase(LOCDIR_CROSS_INDEX_SPACE, &locdir_cross_index);
   LocDirCube ldc;
   locdir_reset_cross(&ldc);
@@ -188,8 +239,9 @@ void cross_stats() {
 
   printf("=== Single ===\n");
   for (size_t i = 0; i < N; ++i) {
+    Prng prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
 
     unsigned char depth = nibble_depth(&tablebase, &ldc);
     depths[depth]++;
@@ -211,16 +263,15 @@ void cross_stats() {
   printf("\n=== Double ===\n");
 
   for (size_t i = 0; i < N; ++i) {
-    int seed = rand();
-    srand(seed);
+    Prng prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     unsigned char white_depth = nibble_depth(&tablebase, &ldc);
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_z(&ldc);
     unsigned char orange_depth = nibble_depth(&tablebase, &ldc);
 
@@ -245,44 +296,43 @@ void cross_stats() {
   printf("\n=== Neutral ===\n");
 
   for (size_t i = 0; i < N; ++i) {
-    int seed = rand();
-    srand(seed);
+    Prng prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     unsigned char white_depth = nibble_depth(&tablebase, &ldc);
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_z(&ldc);
     unsigned char orange_depth = nibble_depth(&tablebase, &ldc);
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_z2(&ldc);
     unsigned char yellow_depth = nibble_depth(&tablebase, &ldc);
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_z_prime(&ldc);
     unsigned char red_depth = nibble_depth(&tablebase, &ldc);
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_x(&ldc);
     unsigned char blue_depth = nibble_depth(&tablebase, &ldc);
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_x_prime(&ldc);
     unsigned char green_depth = nibble_depth(&tablebase, &ldc);
 
@@ -309,7 +359,8 @@ void cross_stats() {
   printf("Average = %g\n", average);
 }
 
-void xcross_stats() {
+// Every section sees the same cases
+void xcross_stats(uint64_t seed) {
   FILE *fptr;
   size_t num_read;
   size_t tablebase_size;
@@ -343,8 +394,9 @@ void xcross_stats() {
 
   printf("=== Single ===\n");
   for (size_t i = 0; i < N; ++i) {
+    Prng prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
 
     unsigned char depth = nibble_depth(&tablebase, &ldc);
     depths[depth]++;
@@ -366,32 +418,31 @@ void xcross_stats() {
   printf("\n=== Single (neutral pair) ===\n");
 
   for (size_t i = 0; i < N; ++i) {
-    int seed = rand();
-    srand(seed);
+    Prng prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     unsigned char depth = nibble_depth(&tablebase, &ldc);
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_y(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y_prime(&ldc);
     unsigned char alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_y2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y2(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_y_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
@@ -416,226 +467,225 @@ void xcross_stats() {
 
   for (size_t i = 0; i < N; ++i) {
     // White
-    int seed = rand();
-    srand(seed);
+    Prng prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     unsigned char depth = nibble_depth(&tablebase, &ldc);
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_y(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y_prime(&ldc);
     unsigned char alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_y2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y2(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_y_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
     // Green
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_x(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x_prime(&ldc);
     locdir_y(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y_prime(&ldc);
     locdir_x(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x_prime(&ldc);
     locdir_y2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y2(&ldc);
     locdir_x(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x_prime(&ldc);
     locdir_y_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y(&ldc);
     locdir_x(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
     // Blue
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_x_prime(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x(&ldc);
     locdir_y(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y_prime(&ldc);
     locdir_x_prime(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x(&ldc);
     locdir_y2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y2(&ldc);
     locdir_x_prime(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x(&ldc);
     locdir_y_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y(&ldc);
     locdir_x_prime(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
     // Orange
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_z(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z_prime(&ldc);
     locdir_y(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y_prime(&ldc);
     locdir_z(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z_prime(&ldc);
     locdir_y2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y2(&ldc);
     locdir_z(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z_prime(&ldc);
     locdir_y_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y(&ldc);
     locdir_z(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
     // Red
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_z_prime(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z(&ldc);
     locdir_y(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y_prime(&ldc);
     locdir_z_prime(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z(&ldc);
     locdir_y2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y2(&ldc);
     locdir_z_prime(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_z(&ldc);
     locdir_y_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y(&ldc);
     locdir_z_prime(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
     // Yellow
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_x2(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x2(&ldc);
     locdir_y(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y_prime(&ldc);
     locdir_x2(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x2(&ldc);
     locdir_y2(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y2(&ldc);
     locdir_x2(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
     depth = depth < alt ? depth : alt;
 
-    srand(seed);
+    prng = init_prng_stream(seed, i);
     locdir_reset(&ldc);
     locdir_x2(&ldc);
     locdir_y_prime(&ldc);
-    locdir_scramble(&ldc);
+    locdir_scramble(&ldc, &prng);
     locdir_y(&ldc);
     locdir_x2(&ldc);
     alt = nibble_depth(&tablebase, &ldc);
@@ -739,15 +789,19 @@ void solve_f2l_pair() {
 }
 
 int main() {
-  srand(time(NULL));
+  uint64_t seed = time(NULL);
+
+  // Prng prng = init_prng(seed);
 
-  // solve_2x2x2();
+  // solve_2x2x2(&prng);
 
-  // solve_3x3x3();
+  // solve_3x3x3(&prng);
 
   // pll_solutions();
 
-  xcross_stats();
+  // benchmark_estimators();
+
+  xcross_stats(seed);
 
   // solve_f2l_pair();
 
@@ -0,0 +1,530 @@
+#define _GNU_SOURCE
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "stdbool.h"
+#include "math.h"
+#include "sched.h"
+
+#include "prng.c"
+#include "cube.c"
+#include "moves.c"
+#include "sequence.c"
+#include "locdir.c"
+#include "tablebase.c"
+#include "goalsphere.c"
+
+/*
+Microbenchmarks of the primitives that the searches spend their time in: move kernels, index functions and table probes.
+
+Every benchmark is warmed up and then timed over a number of repetitions. The throughput of the repetitions is
+summarized by its median, mean, relative standard deviation and range. The process is pinned to a single CPU so that
+migrations between cores do not blur the numbers.
+
+Usage: ./microbench.out [--filter=<substring>] [--repetitions=<count>] [--cpu=<index>] [--max-bytes=<bytes>] [--json=<file>]
+Only benchmarks with the filter in their name run. The process stays on the CPU it started on unless --cpu is given.
+--cpu=-1 disables pinning. Tables and sets larger than --max-bytes (1 GiB by default) are skipped.
+With --json the summaries are also written as JSON lines.
+*/
+
+// Fixed so that every run measures the same inputs
+#define MICROBENCH_SEED (1)
+
+#define MICROBENCH_WARMUP (2)
+#define MICROBENCH_DEFAULT_REPETITIONS (10)
+#define MICROBENCH_DEFAULT_MAX_BYTES (1ULL << 30)
+
+#define MICROBENCH_NUM_MOVES (1 << 20)
+#define MICROBENCH_POOL_SIZE (1 << 12)
+#define MICROBENCH_POOL_ROUNDS (64)
+#define MICROBENCH_NUM_PROBES (1 << 20)
+
+// How many probes ahead the prefetching table lookups request their cache lines
+#define MICROBENCH_PREFETCH_DISTANCE (16)
+
+// Number of set lookups that advance their binary searches in lockstep
+#define MICROBENCH_GROUP_SIZE (16)
+
+typedef struct {
+  const char *filter;
+  size_t repetitions;
+  size_t max_bytes;
+  FILE *json;
+} MicrobenchOptions;
+
+MicrobenchOptions MICROBENCH_OPTIONS;
+
+// Inputs of the benchmark that is being measured. The kernels read them from here.
+typedef struct {
+  enum move *moves;
+  LocDirCube *pool;
+  size_t (*index_func)(LocDirCube*);
+  Nibblebase table;
+  size_t *probes;
+  size_t *set;
+  size_t set_size;
+} MicrobenchInputs;
+
+MicrobenchInputs MICROBENCH_INPUTS;
+
+// Results are accumulated here so that the compiler cannot drop the work being timed
+volatile size_t MICROBENCH_SINK;
+
+double microbench_seconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+int compare_doubles(const void *a, const void *b) {
+  double x = *(const double*) a;
+  double y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+bool microbench_selected(const char *name) {
+  return MICROBENCH_OPTIONS.filter == NULL || strstr(name, MICROBENCH_OPTIONS.filter) != NULL;
+}
+
+// Time num_ops operations of the kernel per repetition and report the throughput
+void measure(const char *name, const char *unit, size_t num_ops, void (*kernel)()) {
+  if (!microbench_selected(name)) {
+    return;
+  }
+  for (size_t i = 0; i < MICROBENCH_WARMUP; ++i) {
+    kernel();
+  }
+  size_t num_repetitions = MICROBENCH_OPTIONS.repetitions;
+  double *rates = malloc(num_repetitions * sizeof(double));
+  for (size_t i = 0; i < num_repetitions; ++i) {
+    double start = microbench_seconds();
+    kernel();
+    rates[i] = num_ops / (microbench_seconds() - start);
+  }
+  qsort(rates, num_repetitions, sizeof(double), compare_doubles);
+
+  double mean = 0;
+  for (size_t i = 0; i < num_repetitions; ++i) {
+    mean += rates[i];
+  }
+  mean /= num_repetitions;
+  double variance = 0;
+  for (size_t i = 0; i < num_repetitions; ++i) {
+    variance += (rates[i] - mean) * (rates[i] - mean);
+  }
+  double stddev = num_repetitions > 1 ? sqrt(variance / (num_repetitions - 1)) : 0;
+  double median = num_repetitions & 1 ? rates[num_repetitions / 2] : 0.5 * (rates[num_repetitions / 2 - 1] + rates[num_repetitions / 2]);
+
+  printf(
+    "%-52s %10.2f M%s/s median %10.2f mean %6.2f%% stddev %10.2f min %10.2f max\n",
+    name, 1e-6 * median, unit, 1e-6 * mean, 100 * stddev / mean, 1e-6 * rates[0], 1e-6 * rates[num_repetitions - 1]
+  );
+  fflush(stdout);
+  if (MICROBENCH_OPTIONS.json != NULL) {
+    fprintf(
+      MICROBENCH_OPTIONS.json,
+      "{\"benchmark\": \"%s\", \"unit\": \"%s/s\", \"ops\": %zu, \"repetitions\": %zu, \"median\": %.6g, \"mean\": %.6g, \"stddev\": %.6g, \"min\": %.6g, \"max\": %.6g}\n",
+      name, unit, num_ops, num_repetitions, median, mean, stddev, rates[0], rates[num_repetitions - 1]
+    );
+  }
+  free(rates);
+}
+
+void pin_to_cpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set)) {
+    fprintf(stderr, "Failed to pin to CPU %d\n", cpu);
+    exit(EXIT_FAILURE);
+  }
+  fprintf(stderr, "Pinned to CPU %d\n", cpu);
+}
+
+// Every move depends on the previous one like it does along a search path
+void bench_apply() {
+  Cube cube;
+  reset(&cube);
+  for (size_t i = 0; i < MICROBENCH_NUM_MOVES; ++i) {
+    apply(&cube, MICROBENCH_INPUTS.moves[i]);
+  }
+  MICROBENCH_SINK += cube.a ^ cube.b ^ cube.c;
+}
+
+void bench_locdir_apply_stable() {
+  LocDirCube ldc;
+  locdir_reset(&ldc);
+  for (size_t i = 0; i < MICROBENCH_NUM_MOVES; ++i) {
+    locdir_apply_stable(&ldc, MICROBENCH_INPUTS.moves[i]);
+  }
+  MICROBENCH_SINK += ldc.corner_locs[0] + ldc.edge_locs[0];
+}
+
+void bench_locdir_apply() {
+  LocDirCube ldc;
+  locdir_reset(&ldc);
+  for (size_t i = 0; i < MICROBENCH_NUM_MOVES; ++i) {
+    locdir_apply(&ldc, MICROBENCH_INPUTS.moves[i]);
+  }
+  MICROBENCH_SINK += ldc.corner_locs[0] + ldc.edge_locs[0];
+}
+
+void bench_moves(Prng *prng) {
+  MICROBENCH_INPUTS.moves = malloc(MICROBENCH_NUM_MOVES * sizeof(enum move));
+  for (size_t i = 0; i < MICROBENCH_NUM_MOVES; ++i) {
+    MICROBENCH_INPUTS.moves[i] = STABLE_MOVES[prng_below(prng, NUM_STABLE_MOVES)];
+  }
+  measure("apply", "moves", MICROBENCH_NUM_MOVES, bench_apply);
+  measure("locdir_apply_stable", "moves", MICROBENCH_NUM_MOVES, bench_locdir_apply_stable);
+  measure("locdir_apply", "moves", MICROBENCH_NUM_MOVES, bench_locdir_apply);
+  free(MICROBENCH_INPUTS.moves);
+}
+
+typedef struct {
+  const char *name;
+  size_t (*index_func)(LocDirCube*);
+  // The index is only defined for cubes of this pool
+  enum {POOL_ANY, POOL_DOMINO, POOL_F2L_SOLVED} pool;
+} IndexBenchmark;
+
+const IndexBenchmark INDEX_BENCHMARKS[] = {
+  {"locdir_corner_index", locdir_corner_index, POOL_ANY},
+  {"locdir_corner_permutation_index", locdir_corner_permutation_index, POOL_ANY},
+  {"locdir_corner_orientation_index", locdir_corner_orientation_index, POOL_ANY},
+  {"locdir_edge_orientation_index", locdir_edge_orientation_index, POOL_ANY},
+  {"locdir_four_corner_index", locdir_four_corner_index, POOL_ANY},
+  {"locdir_edge_index", locdir_edge_index, POOL_ANY},
+  {"locdir_first_7_edge_index", locdir_first_7_edge_index, POOL_ANY},
+  {"locdir_last_7_edge_index", locdir_last_7_edge_index, POOL_ANY},
+  {"locdir_first_4_edge_index", locdir_first_4_edge_index, POOL_ANY},
+  {"locdir_middle_4_edge_index", locdir_middle_4_edge_index, POOL_ANY},
+  {"locdir_last_4_edge_index", locdir_last_4_edge_index, POOL_ANY},
+  {"locdir_cross_index", locdir_cross_index, POOL_ANY},
+  {"locdir_xcross_index", locdir_xcross_index, POOL_ANY},
+  {"locdir_f2l_index", locdir_f2l_index, POOL_ANY},
+  {"locdir_domino_twist_index", locdir_domino_twist_index, POOL_ANY},
+  {"locdir_domino_flip_index", locdir_domino_flip_index, POOL_ANY},
+  {"locdir_domino_slice_index", locdir_domino_slice_index, POOL_ANY},
+  {"locdir_domino_twist_slice_index", locdir_domino_twist_slice_index, POOL_ANY},
+  {"locdir_domino_flip_slice_index", locdir_domino_flip_slice_index, POOL_ANY},
+  {"locdir_domino_edge_permutation_index", locdir_domino_edge_permutation_index, POOL_DOMINO},
+  {"locdir_domino_slice_permutation_index", locdir_domino_slice_permutation_index, POOL_DOMINO},
+  {"locdir_domino_corner_slice_index", locdir_domino_corner_slice_index, POOL_DOMINO},
+  {"locdir_domino_edge_slice_index", locdir_domino_edge_slice_index, POOL_DOMINO},
+  {"locdir_oll_index", locdir_oll_index, POOL_F2L_SOLVED},
+  {"locdir_centerless_hash", locdir_centerless_hash, POOL_ANY},
+};
+
+#define NUM_INDEX_BENCHMARKS (sizeof(INDEX_BENCHMARKS) / sizeof(IndexBenchmark))
+
+// Algorithms that keep the first two layers solved
+const char *F2L_PRESERVING_ALGORITHMS[] = {
+  "U",
+  "R U R' U R U2 R'",
+  "F R U R' U' F'",
+  "R U2 R2 U' R2 U' R2 U2 R",
+  "R2 U R U R' U' R' U' R' U R'",
+};
+
+#define NUM_F2L_PRESERVING_ALGORITHMS (sizeof(F2L_PRESERVING_ALGORITHMS) / sizeof(char*))
+
+void fill_pools(LocDirCube *any, LocDirCube *domino, LocDirCube *f2l_solved, Prng *prng) {
+  enum move domino_moves[NUM_STABLE_MOVES];
+  size_t num_domino_moves = 0;
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    LocDirCube ldc;
+    locdir_reset(&ldc);
+    locdir_apply_stable(&ldc, STABLE_MOVES[i]);
+    if (locdir_domino_solved(&ldc)) {
+      domino_moves[num_domino_moves++] = STABLE_MOVES[i];
+    }
+  }
+
+  for (size_t i = 0; i < MICROBENCH_POOL_SIZE; ++i) {
+    locdir_reset(any + i);
+    locdir_scramble(any + i, prng);
+    locdir_realign(any + i);
+
+    locdir_reset(domino + i);
+    locdir_reset(f2l_solved + i);
+    for (int j = 0; j < 40; ++j) {
+      locdir_apply_stable(domino + i, domino_moves[prng_below(prng, num_domino_moves)]);
+      locdir_apply_string(f2l_solved + i, (char*) F2L_PRESERVING_ALGORITHMS[prng_below(prng, NUM_F2L_PRESERVING_ALGORITHMS)]);
+    }
+    locdir_realign(f2l_solved + i);
+  }
+}
+
+void bench_index() {
+  size_t sum = 0;
+  for (size_t round = 0; round < MICROBENCH_POOL_ROUNDS; ++round) {
+    for (size_t i = 0; i < MICROBENCH_POOL_SIZE; ++i) {
+      sum += MICROBENCH_INPUTS.index_func(MICROBENCH_INPUTS.pool + i);
+    }
+  }
+  MICROBENCH_SINK += sum;
+}
+
+void bench_indices(Prng *prng) {
+  LocDirCube *pools[3];
+  for (int i = 0; i < 3; ++i) {
+    pools[i] = malloc(MICROBENCH_POOL_SIZE * sizeof(LocDirCube));
+  }
+  fill_pools(pools[POOL_ANY], pools[POOL_DOMINO], pools[POOL_F2L_SOLVED], prng);
+
+  for (size_t i = 0; i < NUM_INDEX_BENCHMARKS; ++i) {
+    const IndexBenchmark *benchmark = INDEX_BENCHMARKS + i;
+    MICROBENCH_INPUTS.pool = pools[benchmark->pool];
+    MICROBENCH_INPUTS.index_func = benchmark->index_func;
+    measure(benchmark->name, "indices", MICROBENCH_POOL_ROUNDS * MICROBENCH_POOL_SIZE, bench_index);
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    free(pools[i]);
+  }
+}
+
+void format_bytes(char *buffer, size_t size, size_t num_bytes) {
+  const char *units[] = {"B", "KiB", "MiB", "GiB"};
+  int unit = 0;
+  double amount = num_bytes;
+  while (amount >= 1024 && unit < 3) {
+    amount /= 1024;
+    unit++;
+  }
+  snprintf(buffer, size, "%.4g %s", amount, units[unit]);
+}
+
+typedef struct {
+  const char *name;
+  size_t index_space;
+} TableSize;
+
+void bench_probes() {
+  size_t sum = 0;
+  for (size_t i = 0; i < MICROBENCH_NUM_PROBES; ++i) {
+    sum += get_nibble(&MICROBENCH_INPUTS.table, MICROBENCH_INPUTS.probes[i]);
+  }
+  MICROBENCH_SINK += sum;
+}
+
+void bench_prefetched_probes() {
+  size_t sum = 0;
+  for (size_t i = 0; i < MICROBENCH_NUM_PROBES; ++i) {
+    __builtin_prefetch(MICROBENCH_INPUTS.table.octets + MICROBENCH_INPUTS.probes[i + MICROBENCH_PREFETCH_DISTANCE] / 2);
+    sum += get_nibble(&MICROBENCH_INPUTS.table, MICROBENCH_INPUTS.probes[i]);
+  }
+  MICROBENCH_SINK += sum;
+}
+
+void bench_get_nibble(Prng *prng) {
+  // The index spaces of the tables that the solvers actually load
+  const TableSize sizes[] = {
+    {"edge orientation", LOCDIR_EDGE_ORIENTATION_INDEX_SPACE},
+    {"corner permutation", LOCDIR_CORNER_PERMUTATION_INDEX_SPACE},
+    {"cross", LOCDIR_CROSS_INDEX_SPACE},
+    {"xcross", LOCDIR_XCROSS_INDEX_SPACE},
+    {"corners", LOCDIR_CORNER_INDEX_SPACE},
+    {"first 7 edges", LOCDIR_FIRST_7_EDGE_INDEX_SPACE},
+  };
+  size_t *probes = malloc((MICROBENCH_NUM_PROBES + MICROBENCH_PREFETCH_DISTANCE) * sizeof(size_t));
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(TableSize); ++i) {
+    size_t num_octets = (sizes[i].index_space + 1) / 2;
+    char size_name[32];
+    format_bytes(size_name, sizeof(size_name), num_octets);
+    char name[128];
+    char prefetch_name[128];
+    snprintf(name, sizeof(name), "get_nibble %s (%s)", sizes[i].name, size_name);
+    snprintf(prefetch_name, sizeof(prefetch_name), "get_nibble prefetch %s (%s)", sizes[i].name, size_name);
+    if (!microbench_selected(name) && !microbench_selected(prefetch_name)) {
+      continue;
+    }
+    if (num_octets > MICROBENCH_OPTIONS.max_bytes) {
+      fprintf(stderr, "Skipping the %s table beyond --max-bytes\n", sizes[i].name);
+      continue;
+    }
+
+    Nibblebase table;
+    table.octets = malloc(num_octets);
+    table.visits = NULL;
+    table.num_visits = 0;
+    table.index_func = NULL;
+    // Touch every page so that page faults are not part of the measurement
+    for (size_t j = 0; j < num_octets; ++j) {
+      table.octets[j] = j * 0x9E;
+    }
+    for (size_t j = 0; j < MICROBENCH_NUM_PROBES + MICROBENCH_PREFETCH_DISTANCE; ++j) {
+      probes[j] = prng_below(prng, sizes[i].index_space);
+    }
+
+    MICROBENCH_INPUTS.table = table;
+    MICROBENCH_INPUTS.probes = probes;
+    measure(name, "probes", MICROBENCH_NUM_PROBES, bench_probes);
+    measure(prefetch_name, "probes", MICROBENCH_NUM_PROBES, bench_prefetched_probes);
+    free(table.octets);
+  }
+  free(probes);
+}
+
+/*
+Look up a group of hashes with branchless binary searches that advance in lockstep.
+Both candidates for the next probe of every search are prefetched while the other searches of the group take their step.
+*/
+void set_has_group(size_t *set, size_t size, size_t *hashes, bool *results, bool prefetch) {
+  size_t *bases[MICROBENCH_GROUP_SIZE];
+  for (size_t i = 0; i < MICROBENCH_GROUP_SIZE; ++i) {
+    bases[i] = set;
+  }
+  size_t remaining = size;
+  while (remaining > 1) {
+    size_t half = remaining / 2;
+    size_t next_half = (remaining - half) / 2;
+    for (size_t i = 0; i < MICROBENCH_GROUP_SIZE; ++i) {
+      if (prefetch) {
+        __builtin_prefetch(bases[i] + next_half);
+        __builtin_prefetch(bases[i] + half + next_half);
+      }
+      bases[i] = bases[i][half] <= hashes[i] ? bases[i] + half : bases[i];
+    }
+    remaining -= half;
+  }
+  for (size_t i = 0; i < MICROBENCH_GROUP_SIZE; ++i) {
+    results[i] = size && *bases[i] == hashes[i];
+  }
+}
+
+int compare_hashes(const void *a, const void *b) {
+  size_t x = *(const size_t*) a;
+  size_t y = *(const size_t*) b;
+  return (x > y) - (x < y);
+}
+
+void bench_lookups() {
+  size_t sum = 0;
+  for (size_t i = 0; i < MICROBENCH_NUM_PROBES; ++i) {
+    sum += set_has(MICROBENCH_INPUTS.set, MICROBENCH_INPUTS.set_size, MICROBENCH_INPUTS.probes[i]);
+  }
+  MICROBENCH_SINK += sum;
+}
+
+void bench_group_lookups(bool prefetch) {
+  size_t sum = 0;
+  for (size_t i = 0; i < MICROBENCH_NUM_PROBES; i += MICROBENCH_GROUP_SIZE) {
+    bool results[MICROBENCH_GROUP_SIZE];
+    set_has_group(MICROBENCH_INPUTS.set, MICROBENCH_INPUTS.set_size, MICROBENCH_INPUTS.probes + i, results, prefetch);
+    for (size_t j = 0; j < MICROBENCH_GROUP_SIZE; ++j) {
+      sum += results[j];
+    }
+  }
+  MICROBENCH_SINK += sum;
+}
+
+void bench_lockstep_lookups() {
+  bench_group_lookups(false);
+}
+
+void bench_prefetched_lookups() {
+  bench_group_lookups(true);
+}
+
+void bench_set_has(Prng *prng) {
+  // The sizes of the layers of the goal sphere of the global solver
+  const size_t sizes[] = {1, 27, 501, 9121, 157886, 2612316, 41391832};
+  size_t *queries = malloc(MICROBENCH_NUM_PROBES * sizeof(size_t));
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); ++i) {
+    size_t size = sizes[i];
+    char size_name[32];
+    format_bytes(size_name, sizeof(size_name), size * sizeof(size_t));
+    char name[128];
+    char lockstep_name[128];
+    char prefetch_name[128];
+    snprintf(name, sizeof(name), "set_has %zu (%s)", size, size_name);
+    snprintf(lockstep_name, sizeof(lockstep_name), "set_has lockstep %zu (%s)", size, size_name);
+    snprintf(prefetch_name, sizeof(prefetch_name), "set_has lockstep prefetch %zu (%s)", size, size_name);
+    if (!microbench_selected(name) && !microbench_selected(lockstep_name) && !microbench_selected(prefetch_name)) {
+      continue;
+    }
+    if (size * sizeof(size_t) > MICROBENCH_OPTIONS.max_bytes) {
+      fprintf(stderr, "Skipping the set of %zu hashes beyond --max-bytes\n", size);
+      continue;
+    }
+
+    size_t *set = malloc(size * sizeof(size_t));
+    for (size_t j = 0; j < size; ++j) {
+      set[j] = prng_next(prng);
+    }
+    qsort(set, size, sizeof(size_t), compare_hashes);
+    // Half of the lookups hit like the lookups of a search that reaches the goal sphere
+    for (size_t j = 0; j < MICROBENCH_NUM_PROBES; ++j) {
+      queries[j] = j & 1 ? set[prng_below(prng, size)] : prng_next(prng);
+    }
+    for (size_t j = 0; j < MICROBENCH_NUM_PROBES; j += MICROBENCH_GROUP_SIZE) {
+      bool results[MICROBENCH_GROUP_SIZE];
+      set_has_group(set, size, queries + j, results, true);
+      for (size_t k = 0; k < MICROBENCH_GROUP_SIZE; ++k) {
+        if (results[k] != set_has(set, size, queries[j + k])) {
+          fprintf(stderr, "Lockstep lookup of %zu disagrees with set_has\n", queries[j + k]);
+          exit(EXIT_FAILURE);
+        }
+      }
+    }
+
+    MICROBENCH_INPUTS.set = set;
+    MICROBENCH_INPUTS.set_size = size;
+    MICROBENCH_INPUTS.probes = queries;
+    measure(name, "probes", MICROBENCH_NUM_PROBES, bench_lookups);
+    measure(lockstep_name, "probes", MICROBENCH_NUM_PROBES, bench_lockstep_lookups);
+    measure(prefetch_name, "probes", MICROBENCH_NUM_PROBES, bench_prefetched_lookups);
+    free(set);
+  }
+  free(queries);
+}
+
+int main(int argc, char *argv[]) {
+  MICROBENCH_OPTIONS.filter = NULL;
+  MICROBENCH_OPTIONS.repetitions = MICROBENCH_DEFAULT_REPETITIONS;
+  MICROBENCH_OPTIONS.max_bytes = MICROBENCH_DEFAULT_MAX_BYTES;
+  MICROBENCH_OPTIONS.json = NULL;
+  int cpu = sched_getcpu();
+  for (int i = 1; i < argc; ++i) {
+    if (!strncmp(argv[i], "--filter=", 9)) {
+      MICROBENCH_OPTIONS.filter = argv[i] + 9;
+    } else if (!strncmp(argv[i], "--repetitions=", 14)) {
+      MICROBENCH_OPTIONS.repetitions = atoi(argv[i] + 14);
+    } else if (!strncmp(argv[i], "--cpu=", 6)) {
+      cpu = atoi(argv[i] + 6);
+    } else if (!strncmp(argv[i], "--max-bytes=", 12)) {
+      MICROBENCH_OPTIONS.max_bytes = strtoull(argv[i] + 12, NULL, 10);
+    } else if (!strncmp(argv[i], "--json=", 7)) {
+      MICROBENCH_OPTIONS.json = fopen(argv[i] + 7, "w");
+      if (MICROBENCH_OPTIONS.json == NULL) {
+        fprintf(stderr, "Failed to open %s\n", argv[i] + 7);
+        exit(EXIT_FAILURE);
+      }
+    } else {
+      fprintf(stderr, "Unrecognized argument %s\n", argv[i]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (MICROBENCH_OPTIONS.repetitions < 1) {
+    MICROBENCH_OPTIONS.repetitions = 1;
+  }
+  if (cpu >= 0) {
+    pin_to_cpu(cpu);
+  }
+  Prng prng = init_prng(MICROBENCH_SEED);
+
+  bench_moves(&prng);
+  bench_indices(&prng);
+  bench_get_nibble(&prng);
+  bench_set_has(&prng);
+
+  if (MICROBENCH_OPTIONS.json != NULL) {
+    fclose(MICROBENCH_OPTIONS.json);
+  }
+  return EXIT_SUCCESS;
+}
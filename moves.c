@@ -857,9 +857,9 @@ void compensate(Cube *cube, enum move move) {
 
 /* Cube utilities */
 
-void scramble(Cube *cube) {
+void scramble(Cube *cube, Prng *prng) {
   for (int i = 0; i < 100; ++i) {
-    int r = rand() % 6;
+    int r = prng_below(prng, 6);
     switch(r) {
       case 0:
         turn_U(cube);
@@ -883,9 +883,9 @@ void scramble(Cube *cube) {
   }
 }
 
-void roll(Cube *cube) {
+void roll(Cube *cube, Prng *prng) {
   for (int i = 0; i < 100; ++i) {
-    int r = rand() % 2;
+    int r = prng_below(prng, 2);
     switch(r) {
       case 0:
         rotate_y_prime(cube);
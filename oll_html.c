@@ -4,6 +4,7 @@
 #include "stdbool.h"
 #include "assert.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
@@ -63,9 +64,24 @@ int main() {
   #endif
 
   LocDirCube root;
-  fprintf(stderr, "Generating an OLL goal sphere of radius %zu.\n", radius);
   locdir_reset(&root);
-  GoalSphere sphere = init_goalsphere(&root, radius, &locdir_oll_index);
+  #ifdef SCISSORS_ENABLED
+  char *sphere_path = "./tables/oll_sphere_extended_scissors.bin";
+  #else
+  char *sphere_path = "./tables/oll_sphere_extended.bin";
+  #endif
+  // Layers stored by a previous run are reused and only the missing ones are generated
+  GoalSphere sphere;
+  if (!load_goalsphere(&sphere, sphere_path, &locdir_oll_index, NULL)) {
+    sphere = init_goalsphere(&root, 0, &locdir_oll_index);
+  }
+  if (sphere.num_sets <= radius) {
+    fprintf(stderr, "Extending an OLL goal sphere of radius %zu to radius %zu.\n", sphere.num_sets - 1, radius);
+    extend_goalsphere(&sphere, &root, radius);
+    if (!save_goalsphere(&sphere, sphere_path)) {
+      fprintf(stderr, "Failed to store the goal sphere.\n");
+    }
+  }
 
   char *algos[] = {
     "",
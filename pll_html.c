@@ -5,6 +5,7 @@
 #include "math.h"
 #include "assert.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
@@ -12,6 +13,7 @@
 #include "tablebase.c"
 #include "goalsphere.c"
 #include "ida_star.c"
+#include "solution_cache.c"
 #include "global_solver.c"
 
 /* Display the F face as blue. */
@@ -198,9 +200,22 @@ int main() {
 
   #ifndef SCISSORS_ENABLED
   fprintf(stderr, "Enhancing the global goalsphere.\n");
-  free_goalsphere(&GLOBAL_SOLVER.goal);
-  locdir_reset(&root);
-  GLOBAL_SOLVER.goal = init_goalsphere(&root, 7, &locdir_centerless_hash);
+  #if GLOBAL_SYMMETRIC_GOAL
+  char *enhanced_path = "./tables/centerless_symmetric_sphere_7.bin";
+  #else
+  char *enhanced_path = "./tables/centerless_sphere_7.bin";
+  #endif
+  GoalSphere enhanced;
+  if (load_goalsphere(&enhanced, enhanced_path, GLOBAL_SOLVER.goal.hash_func, GLOBAL_SOLVER.goal.tag_func)) {
+    free_goalsphere(&GLOBAL_SOLVER.goal);
+    GLOBAL_SOLVER.goal = enhanced;
+  }
+  if (GLOBAL_SOLVER.goal.num_sets <= 7) {
+    extend_centerless_goalsphere(&GLOBAL_SOLVER.goal, 7);
+    if (!save_goalsphere(&GLOBAL_SOLVER.goal, enhanced_path)) {
+      fprintf(stderr, "Failed to store the enhanced goalsphere.\n");
+    }
+  }
   #endif
 
   char *names[] = {
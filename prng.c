@@ -0,0 +1,66 @@
+#include "stdint.h"
+
+/*
+Seedable pseudorandom number generator (xoshiro256**) used instead of rand().
+
+The whole state is a small value owned by its user. A generator can be handed to a thread, copied to replay
+the same draws or derived for each case of a run with init_prng_stream so that parallel runs are reproducible.
+*/
+
+typedef struct {
+  uint64_t s[4];
+} Prng;
+
+// Step of splitmix64, which spreads a seed over the whole state
+uint64_t splitmix64(uint64_t *x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+Prng init_prng(uint64_t seed) {
+  Prng prng;
+  for (int i = 0; i < 4; ++i) {
+    prng.s[i] = splitmix64(&seed);
+  }
+  return prng;
+}
+
+/*
+Generator for the stream'th case of a run with the given seed.
+The draws of a case do not depend on which thread handles it or in which order the cases are handled.
+Distinct streams start from unrelated points of the 2^256 - 1 period so they do not overlap in practice.
+*/
+Prng init_prng_stream(uint64_t seed, uint64_t stream) {
+  return init_prng(seed ^ splitmix64(&stream));
+}
+
+uint64_t prng_rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+uint64_t prng_next(Prng *prng) {
+  uint64_t *s = prng->s;
+  uint64_t result = prng_rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = prng_rotl(s[3], 45);
+  return result;
+}
+
+// Uniform in [0, bound) without the bias of taking a remainder
+uint64_t prng_below(Prng *prng, uint64_t bound) {
+  unsigned __int128 product = (unsigned __int128) prng_next(prng) * bound;
+  if ((uint64_t) product < bound) {
+    uint64_t threshold = -bound % bound;
+    while ((uint64_t) product < threshold) {
+      product = (unsigned __int128) prng_next(prng) * bound;
+    }
+  }
+  return product >> 64;
+}
@@ -825,7 +825,7 @@ enum move FACE_TURNS[] = {
   B, B_prime, B2,
 };
 
-sequence make_scramble(Cube *root, int length) {
+sequence make_scramble(Cube *root, int length, Prng *prng) {
   if (length > SEQUENCE_MAX_LENGTH) {
     fprintf(stderr, "Desired sramble length too long");
     exit(EXIT_FAILURE);
@@ -839,7 +839,7 @@ sequence make_scramble(Cube *root, int length) {
   int prev_prev_face_bucket = -1;
   int prev_face_bucket = -1;
   while (index <= length) {
-    int turn_index = rand() % NUM_FACE_TURNS;
+    int turn_index = prng_below(prng, NUM_FACE_TURNS);
     int face_bucket = turn_index / 3;
     int commuting_bucket = face_bucket / 2;
     int prev_commuting_bucket = prev_face_bucket / 2;
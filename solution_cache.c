@@ -0,0 +1,239 @@
+/*
+LRU cache of solutions keyed by the canonical form of the cube under whole-cube rotations and inversion.
+
+Symmetric positions have solutions of the same length so a single entry serves all up to 48 of them.
+Solutions are stored for the canonical representative and mapped through the symmetry on the way in and out.
+The cubes must have their centers in the standard position.
+*/
+
+#define SOLUTION_CACHE_NONE (~(size_t)0)
+
+typedef struct {
+  unsigned __int128 key;
+  sequence solution;
+  // Least recently used list
+  size_t newer;
+  size_t older;
+  // Chain of entries sharing a bucket
+  size_t next;
+} SolutionCacheEntry;
+
+typedef struct {
+  SolutionCacheEntry *entries;
+  size_t num_entries;
+  size_t capacity;
+  size_t *buckets;
+  size_t num_buckets;
+  size_t newest;
+  size_t oldest;
+  size_t lookups;
+  size_t hits;
+  size_t insertions;
+  size_t evictions;
+} SolutionCache;
+
+SolutionCache init_solution_cache(size_t capacity) {
+  SolutionCache cache;
+  cache.capacity = capacity;
+  cache.num_entries = 0;
+  cache.entries = malloc(capacity * sizeof(SolutionCacheEntry));
+  cache.num_buckets = 1;
+  while (cache.num_buckets < capacity) {
+    cache.num_buckets *= 2;
+  }
+  cache.buckets = malloc(cache.num_buckets * sizeof(size_t));
+  if ((capacity && cache.entries == NULL) || cache.buckets == NULL) {
+    fprintf(stderr, "Failed to allocate solution cache of %zu entries.\n", capacity);
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < cache.num_buckets; ++i) {
+    cache.buckets[i] = SOLUTION_CACHE_NONE;
+  }
+  cache.newest = SOLUTION_CACHE_NONE;
+  cache.oldest = SOLUTION_CACHE_NONE;
+  cache.lookups = 0;
+  cache.hits = 0;
+  cache.insertions = 0;
+  cache.evictions = 0;
+  prepare_locdir_orientations();
+  return cache;
+}
+
+void free_solution_cache(SolutionCache *cache) {
+  free(cache->entries);
+  free(cache->buckets);
+}
+
+size_t *solution_cache_bucket(SolutionCache *cache, unsigned __int128 key) {
+  size_t mixed = ((size_t) key ^ (size_t)(key >> 64)) * 0x9E3779B97F4A7C15ULL;
+  return cache->buckets + ((mixed >> 20) & (cache->num_buckets - 1));
+}
+
+size_t solution_cache_find(SolutionCache *cache, unsigned __int128 key) {
+  size_t index = *solution_cache_bucket(cache, key);
+  while (index != SOLUTION_CACHE_NONE && cache->entries[index].key != key) {
+    index = cache->entries[index].next;
+  }
+  return index;
+}
+
+void solution_cache_unlink(SolutionCache *cache, size_t index) {
+  SolutionCacheEntry *entry = cache->entries + index;
+  if (entry->newer == SOLUTION_CACHE_NONE) {
+    cache->newest = entry->older;
+  } else {
+    cache->entries[entry->newer].older = entry->older;
+  }
+  if (entry->older == SOLUTION_CACHE_NONE) {
+    cache->oldest = entry->newer;
+  } else {
+    cache->entries[entry->older].newer = entry->newer;
+  }
+}
+
+void solution_cache_push_newest(SolutionCache *cache, size_t index) {
+  SolutionCacheEntry *entry = cache->entries + index;
+  entry->newer = SOLUTION_CACHE_NONE;
+  entry->older = cache->newest;
+  if (cache->newest == SOLUTION_CACHE_NONE) {
+    cache->oldest = index;
+  } else {
+    cache->entries[cache->newest].newer = index;
+  }
+  cache->newest = index;
+}
+
+void solution_cache_unchain(SolutionCache *cache, size_t index) {
+  size_t *it = solution_cache_bucket(cache, cache->entries[index].key);
+  while (*it != index) {
+    it = &cache->entries[*it].next;
+  }
+  *it = cache->entries[index].next;
+}
+
+// Store a solution of the canonical representative with the given key
+void solution_cache_insert(SolutionCache *cache, unsigned __int128 key, sequence solution) {
+  if (!cache->capacity) {
+    return;
+  }
+  size_t index = solution_cache_find(cache, key);
+  if (index != SOLUTION_CACHE_NONE) {
+    cache->entries[index].solution = solution;
+    solution_cache_unlink(cache, index);
+    solution_cache_push_newest(cache, index);
+    return;
+  }
+  if (cache->num_entries < cache->capacity) {
+    index = cache->num_entries++;
+  } else {
+    index = cache->oldest;
+    solution_cache_unlink(cache, index);
+    solution_cache_unchain(cache, index);
+    cache->evictions++;
+  }
+  SolutionCacheEntry *entry = cache->entries + index;
+  entry->key = key;
+  entry->solution = solution;
+  size_t *bucket = solution_cache_bucket(cache, key);
+  entry->next = *bucket;
+  *bucket = index;
+  solution_cache_push_newest(cache, index);
+  cache->insertions++;
+}
+
+// Returns true and writes a solution of the cube if a symmetric position has been stored
+bool solution_cache_get(SolutionCache *cache, LocDirCube *ldc, sequence *solution) {
+  cache->lookups++;
+  LocDirCube canonical;
+  size_t orientation;
+  bool inverted;
+  locdir_centerless_canonical_with(&canonical, ldc, true, &orientation, &inverted);
+  size_t index = solution_cache_find(cache, locdir_centerless_rank(&canonical));
+  if (index == SOLUTION_CACHE_NONE) {
+    return false;
+  }
+  cache->hits++;
+  solution_cache_unlink(cache, index);
+  solution_cache_push_newest(cache, index);
+
+  // Undo the conjugation and then the inversion
+  sequence result = locdir_conjugate_sequence(cache->entries[index].solution, LOCDIR_INVERSE_ORIENTATION_INDEX[orientation]);
+  if (inverted) {
+    LocDirCube inverse;
+    locdir_invert(&inverse, ldc);
+    result = locdir_invert_solution(&inverse, result);
+  }
+  *solution = result;
+  return true;
+}
+
+void solution_cache_put(SolutionCache *cache, LocDirCube *ldc, sequence solution) {
+  LocDirCube canonical;
+  size_t orientation;
+  bool inverted;
+  locdir_centerless_canonical_with(&canonical, ldc, true, &orientation, &inverted);
+  if (inverted) {
+    solution = locdir_invert_solution(ldc, solution);
+  }
+  solution_cache_insert(cache, locdir_centerless_rank(&canonical), locdir_conjugate_sequence(solution, orientation));
+}
+
+void fprint_solution_cache_stats(FILE *file, SolutionCache *cache) {
+  fprintf(
+    file,
+    "Solution cache: %zu of %zu entries, %zu lookups, %zu hits (%g%%), %zu insertions, %zu evictions\n",
+    cache->num_entries,
+    cache->capacity,
+    cache->lookups,
+    cache->hits,
+    cache->lookups ? 100.0 * cache->hits / cache->lookups : 0.0,
+    cache->insertions,
+    cache->evictions
+  );
+}
+
+// Stores the entries from the oldest to the newest so that reading them back keeps the LRU order
+void fwrite_solution_cache(SolutionCache *cache, FILE *fptr) {
+  fwrite(&cache->num_entries, sizeof(size_t), 1, fptr);
+  for (size_t index = cache->oldest; index != SOLUTION_CACHE_NONE; index = cache->entries[index].newer) {
+    fwrite(&cache->entries[index].key, sizeof(unsigned __int128), 1, fptr);
+    fwrite(&cache->entries[index].solution, sizeof(sequence), 1, fptr);
+  }
+}
+
+// Only the newest entries are kept if the capacity is smaller than what was stored
+void fread_solution_cache(SolutionCache *cache, FILE *fptr) {
+  size_t num_entries;
+  fread_exactly(&num_entries, sizeof(size_t), 1, fptr);
+  for (size_t i = 0; i < num_entries; ++i) {
+    unsigned __int128 key;
+    sequence solution;
+    fread_exactly(&key, sizeof(unsigned __int128), 1, fptr);
+    fread_exactly(&solution, sizeof(sequence), 1, fptr);
+    solution_cache_insert(cache, key, solution);
+  }
+  // Loading is not traffic
+  cache->insertions = 0;
+  cache->evictions = 0;
+}
+
+bool save_solution_cache(SolutionCache *cache, const char *path) {
+  FILE *fptr = fopen(path, "wb");
+  if (fptr == NULL) {
+    return false;
+  }
+  fwrite_solution_cache(cache, fptr);
+  fclose(fptr);
+  return true;
+}
+
+// Returns false if there is no cache stored at the path
+bool load_solution_cache(SolutionCache *cache, const char *path) {
+  FILE *fptr = fopen(path, "rb");
+  if (fptr == NULL) {
+    return false;
+  }
+  fread_solution_cache(cache, fptr);
+  fclose(fptr);
+  return true;
+}
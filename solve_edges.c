@@ -3,6 +3,7 @@
 #include "time.h"
 #include "stdbool.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
@@ -12,7 +13,7 @@
 #include "ida_star.c"
 
 int main() {
-  srand(time(NULL));
+  Prng prng = init_prng(time(NULL));
 
   FILE *fptr;
   size_t num_read;
@@ -51,10 +52,22 @@ int main() {
   printf("Loading database for the last 6 moves of an edges-only cube.\n");
   GoalSphere edge_sphere;
   edge_sphere.hash_func = locdir_edge_index;
+  edge_sphere.tag_func = NULL;
+  edge_sphere.tags = NULL;
+  edge_sphere.filters = NULL;
   edge_sphere.num_sets = 6 + 1;
   edge_sphere.sets = malloc(edge_sphere.num_sets * sizeof(size_t*));
   edge_sphere.set_sizes = malloc(edge_sphere.num_sets * sizeof(size_t));
   edge_sphere.set_sizes[0] = 1;
+  #ifdef SCISSORS_ENABLED
+  edge_sphere.set_sizes[1] = 45;
+  edge_sphere.set_sizes[2] = 1347;
+  edge_sphere.set_sizes[3] = 39471;
+  edge_sphere.set_sizes[4] = 1090256;
+  edge_sphere.set_sizes[5] = 28178805;
+  edge_sphere.set_sizes[6] = 690100863;
+  fptr = fopen("./tables/edge_sphere_scissors.bin", "rb");
+  #else
   edge_sphere.set_sizes[1] = 27;
   edge_sphere.set_sizes[2] = 501;
   edge_sphere.set_sizes[3] = 9121;
@@ -62,6 +75,7 @@ int main() {
   edge_sphere.set_sizes[5] = 2612316;
   edge_sphere.set_sizes[6] = 41391832;
   fptr = fopen("./tables/edge_sphere.bin", "rb");
+  #endif
   if (fptr == NULL) {
     fprintf(stderr, "Failed to open file.\n");
     exit(EXIT_FAILURE);
@@ -96,9 +110,7 @@ int main() {
     return goalsphere_shell(&edge_sphere, ldc);
   }
 
-  IDAstar ida;
-  ida.estimator = estimator;
-  ida.is_solved = is_solved;
+  IDAstar ida = init_ida_star(is_solved, estimator);
 
   Cube cube;
   LocDirCube edges;
@@ -111,7 +123,7 @@ int main() {
   for (size_t j = 0; j < 5; j++) {
     printf("Scramble:\n");
     locdir_realign(&edges);
-    locdir_scramble(&edges);
+    locdir_scramble(&edges, &prng);
     cube = to_cube(&edges);
     render(&cube);
 
@@ -120,13 +132,13 @@ int main() {
       continue;
     }
 
-    ida_star_solve(&ida, &edges);
+    ida_star_solve(&ida, &edges, 0);
 
-    printf("Found a solution in %zu moves:\n", ida.path_length - 1 + sphere_depth);
+    printf("Found a solution in %zu moves:\n", ida.num_moves + sphere_depth);
 
     sequence first_steps = ida_to_sequence(&ida);
     locdir_apply_sequence(&edges, first_steps);
-    sequence final_steps = goalsphere_solve(&edge_sphere, &edges, 0);
+    sequence final_steps = goalsphere_solve(&edge_sphere, &edges, 0, &is_better);
     locdir_apply_sequence(&edges, final_steps);
     print_sequence(concat(first_steps, final_steps));
     cube = to_cube(&edges);
@@ -143,15 +155,15 @@ int main() {
   size_t max_moves = 0;
   for (size_t i = 0; i < total_solves; ++i) {
     locdir_reset_edges(&edges);
-    locdir_scramble(&edges);
+    locdir_scramble(&edges, &prng);
 
     if (goalsphere_depth(&edge_sphere, &edges, 0) <= sphere_depth) {
       min_moves = 0;
       continue;
     }
 
-    ida_star_solve(&ida, &edges);
-    size_t num_moves = ida.path_length - 1;
+    ida_star_solve(&ida, &edges, 0);
+    size_t num_moves = ida.num_moves;
     total_moves += num_moves;
     if (num_moves < min_moves) {
       min_moves = num_moves;
@@ -0,0 +1,87 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "stdbool.h"
+
+#include "prng.c"
+#include "cube.c"
+#include "moves.c"
+#include "sequence.c"
+#include "locdir.c"
+#include "solver_protocol.c"
+
+/*
+Command line client for solver_daemon.c.
+
+Usage: ./solver-client.out <solve|all|bound|xcross|xcross-solve|fast|anytime|ping> [scramble] [options]
+The options of fast are [target length] [budget in ms] and those of anytime [budget in ms] [max nodes].
+Anytime prints the proven lower bound instead of the depth.
+*/
+
+const char *SOLVER_COMMANDS[] = {"ping", "solve", "all", "bound", "xcross", "xcross-solve", "fast", "anytime"};
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <solve|all|bound|xcross|xcross-solve|fast|anytime|ping> [scramble] [options]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  enum solver_request_type type = NUM_SOLVER_REQUEST_TYPES;
+  for (int i = 0; i < NUM_SOLVER_REQUEST_TYPES; ++i) {
+    if (!strcmp(argv[1], SOLVER_COMMANDS[i])) {
+      type = i;
+    }
+  }
+  if (type == NUM_SOLVER_REQUEST_TYPES) {
+    fprintf(stderr, "Unrecognized command %s\n", argv[1]);
+    exit(EXIT_FAILURE);
+  }
+
+  SolverRequest request;
+  memset(&request, 0, sizeof(request));
+  request.type = type;
+  locdir_reset(&request.ldc);
+  if (argc > 2) {
+    locdir_apply_string(&request.ldc, argv[2]);
+    locdir_realign(&request.ldc);
+  }
+  if (type == SOLVER_SOLVE_TWO_PHASE) {
+    request.target_length = argc > 3 ? atoi(argv[3]) : 0;
+    request.budget_ms = argc > 4 ? atoi(argv[4]) : 0;
+  } else if (type == SOLVER_SOLVE_BUDGETED) {
+    request.budget_ms = argc > 3 ? atoi(argv[3]) : 0;
+    request.max_nodes = argc > 4 ? strtoull(argv[4], NULL, 10) : 0;
+  }
+
+  int fd = solver_connect();
+  if (fd < 0) {
+    fprintf(stderr, "Failed to connect to %s. Is the solver daemon running?\n", SOLVER_SOCKET_PATH);
+    exit(EXIT_FAILURE);
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  SolverResponse response;
+  collection solutions = solver_send_request(fd, &request, &response);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  close(fd);
+
+  if (solutions == NULL) {
+    fprintf(stderr, "Connection lost.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (response.status != SOLVER_OK) {
+    fprintf(stderr, response.status == SOLVER_UNAVAILABLE ? "Table not loaded by the daemon.\n" : "Bad request.\n");
+    free(solutions);
+    exit(EXIT_FAILURE);
+  }
+
+  printf("%u\n", response.depth);
+  for (collection it = solutions; *it != SENTINEL; ++it) {
+    print_sequence(*it);
+  }
+  fprintf(stderr, "Round trip in %g ms\n", (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) * 1e-6);
+
+  free(solutions);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "time.h"
+#include "stdbool.h"
+#include "math.h"
+#include "signal.h"
+
+#include "prng.c"
+#include "cube.c"
+#include "moves.c"
+#include "sequence.c"
+#include "locdir.c"
+#include "tablebase.c"
+#include "goalsphere.c"
+#include "ida_star.c"
+#include "solution_cache.c"
+#include "global_solver.c"
+#include "two_phase.c"
+#include "solver_protocol.c"
+
+/*
+Resident solver that keeps the tables in memory and answers requests over SOLVER_SOCKET_PATH.
+
+Every worker thread blocks in accept() on the shared listening socket and serves one connection at a time
+with its own IDA* search states. Compile with -fopenmp to get one warm worker per thread.
+*/
+
+#define SOLVER_LISTEN_BACKLOG (64)
+
+// Budget of requests that do not give one
+#define SOLVER_DEFAULT_BUDGET (1.0)
+
+// Part of the budget of an anytime request spent on the two-phase solution that the optimal search tries to beat
+#define SOLVER_SEED_BUDGET_FRACTION (0.1)
+
+typedef struct {
+  Nibblebase xcross;
+  bool has_xcross;
+} DaemonTables;
+
+DaemonTables DAEMON_TABLES;
+
+void load_xcross_table() {
+  #ifdef SCISSORS_ENABLED
+  FILE *fptr = fopen("./tables/xcross_scissors.bin", "rb");
+  #else
+  FILE *fptr = fopen("./tables/xcross.bin", "rb");
+  #endif
+  if (fptr == NULL) {
+    fprintf(stderr, "No tablebase for xcross. Xcross requests will be refused.\n");
+    DAEMON_TABLES.has_xcross = false;
+    return;
+  }
+  fprintf(stderr, "Loading tablebase for xcross...\n");
+  DAEMON_TABLES.xcross = init_nibblebase(LOCDIR_XCROSS_INDEX_SPACE, &locdir_xcross_index);
+  size_t tablebase_size = (LOCDIR_XCROSS_INDEX_SPACE + 1)/2;
+  size_t num_read = fread(DAEMON_TABLES.xcross.octets, sizeof(unsigned char), tablebase_size, fptr);
+  if (num_read != tablebase_size) {
+    fprintf(stderr, "Failed to load data. Only %zu of %zu read.\n", num_read, tablebase_size);
+    exit(EXIT_FAILURE);
+  }
+  fclose(fptr);
+  DAEMON_TABLES.has_xcross = true;
+}
+
+bool send_response(int fd, enum solver_status status, unsigned int depth, collection sequences) {
+  SolverResponse response;
+  response.status = status;
+  response.depth = depth;
+  response.num_sequences = sequences == NULL ? 0 : collection_size(sequences);
+  if (!solver_write_fully(fd, &response, sizeof(response))) {
+    return false;
+  }
+  return solver_write_fully(fd, sequences, response.num_sequences * sizeof(sequence));
+}
+
+bool send_sequence(int fd, sequence seq) {
+  sequence sequences[2] = {seq, SENTINEL};
+  return send_response(fd, SOLVER_OK, sequence_length(seq), sequences);
+}
+
+// Serve requests until the client hangs up
+void serve_connection(int fd, IDAstar *ida, IDAstar *edge_ida) {
+  SolverRequest request;
+  while (solver_read_fully(fd, &request, sizeof(request))) {
+    bool sent;
+    if (request.type >= NUM_SOLVER_REQUEST_TYPES) {
+      sent = send_response(fd, SOLVER_BAD_REQUEST, 0, NULL);
+    } else if (request.type == SOLVER_PING) {
+      sent = send_response(fd, SOLVER_OK, SOLVER_PROTOCOL_VERSION, NULL);
+    } else if (!locdir_is_solvable(&request.ldc)) {
+      sent = send_response(fd, SOLVER_BAD_REQUEST, 0, NULL);
+    } else if (request.type == SOLVER_SOLVE) {
+      sent = send_sequence(fd, global_solve_with(ida, edge_ida, &request.ldc, false));
+    } else if (request.type == SOLVER_SOLVE_TWO_PHASE) {
+      size_t target_length = request.target_length ? request.target_length : TWO_PHASE_DEFAULT_TARGET_LENGTH;
+      double budget = request.budget_ms ? 1e-3 * request.budget_ms : TWO_PHASE_DEFAULT_TIME_BUDGET;
+      sent = send_sequence(fd, first_stable_expansion(two_phase_solve(&request.ldc, target_length, budget)));
+    } else if (request.type == SOLVER_SOLVE_BUDGETED) {
+      double time_budget = request.budget_ms ? 1e-3 * request.budget_ms : SOLVER_DEFAULT_BUDGET;
+      SearchBudget budget = init_search_budget(time_budget, request.max_nodes);
+      sequence seed = first_stable_expansion(two_phase_solve(&request.ldc, TWO_PHASE_DEFAULT_TARGET_LENGTH, SOLVER_SEED_BUDGET_FRACTION * time_budget));
+      unsigned char lower_bound;
+      sequence solution = global_solve_budgeted(ida, edge_ida, &request.ldc, seed, &budget, false, &lower_bound);
+      sequence sequences[2] = {solution, SENTINEL};
+      sent = send_response(fd, SOLVER_OK, lower_bound, solution == INVALID ? NULL : sequences);
+    } else if (request.type == SOLVER_SOLVE_ALL) {
+      collection solutions = global_solve_all_with(ida, edge_ida, &request.ldc);
+      unsigned int depth = solutions[0] == SENTINEL ? 0 : sequence_length(solutions[0]);
+      sent = send_response(fd, SOLVER_OK, depth, solutions);
+      free(solutions);
+    } else if (request.type == SOLVER_LOWER_BOUND) {
+      unsigned int depth = goalsphere_depth(&GLOBAL_SOLVER.goal, &request.ldc, 0);
+      if (depth == UNKNOWN) {
+        // Everything outside the goal sphere is at least one move past its last layer
+        depth = global_lower_bound_with(edge_ida, &request.ldc) + GLOBAL_SOLVER.goal.num_sets - 1;
+        if (depth < GLOBAL_SOLVER.goal.num_sets) {
+          depth = GLOBAL_SOLVER.goal.num_sets;
+        }
+      }
+      sent = send_response(fd, SOLVER_OK, depth, NULL);
+    } else if (!DAEMON_TABLES.has_xcross) {
+      sent = send_response(fd, SOLVER_UNAVAILABLE, 0, NULL);
+    } else if (request.type == SOLVER_XCROSS_DEPTH) {
+      sent = send_response(fd, SOLVER_OK, nibble_depth(&DAEMON_TABLES.xcross, &request.ldc), NULL);
+    } else {
+      sent = send_sequence(fd, nibble_solve(&DAEMON_TABLES.xcross, &request.ldc, &is_better_semistable));
+    }
+    if (!sent) {
+      return;
+    }
+  }
+}
+
+int main() {
+  // Clients hanging up mid-response should not take the daemon down
+  signal(SIGPIPE, SIG_IGN);
+
+  load_xcross_table();
+  prepare_global_solver();
+  prepare_two_phase_solver();
+
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    fprintf(stderr, "Failed to create socket.\n");
+    exit(EXIT_FAILURE);
+  }
+  struct sockaddr_un address = solver_address();
+  unlink(SOLVER_SOCKET_PATH);
+  if (bind(listen_fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+    fprintf(stderr, "Failed to bind %s\n", SOLVER_SOCKET_PATH);
+    exit(EXIT_FAILURE);
+  }
+  if (listen(listen_fd, SOLVER_LISTEN_BACKLOG) < 0) {
+    fprintf(stderr, "Failed to listen on %s\n", SOLVER_SOCKET_PATH);
+    exit(EXIT_FAILURE);
+  }
+  fprintf(stderr, "Listening on %s\n", SOLVER_SOCKET_PATH);
+
+  #pragma omp parallel
+  {
+    IDAstar ida = GLOBAL_SOLVER.ida;
+    IDAstar edge_ida = GLOBAL_SOLVER.edge_ida;
+    // Exhausted subtrees of one search say nothing about another search running at the same time
+    ida.table = NULL;
+    edge_ida.table = NULL;
+    for (;;) {
+      int fd = accept(listen_fd, NULL, NULL);
+      if (fd < 0) {
+        continue;
+      }
+      serve_connection(fd, &ida, &edge_ida);
+      close(fd);
+    }
+  }
+}
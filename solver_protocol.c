@@ -0,0 +1,144 @@
+#include "stdint.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/socket.h"
+#include "sys/un.h"
+
+/*
+Binary protocol between solver_daemon.c and its clients over a Unix domain socket.
+
+A client sends fixed size SolverRequests and receives a SolverResponse header for each one,
+followed by num_sequences raw sequences. Both ends run on the same machine from the same sources
+so the structs are sent as is. A connection can be reused for any number of requests.
+*/
+
+#ifdef SCISSORS_ENABLED
+#define SOLVER_SOCKET_PATH "/tmp/speedcube_solver_scissors.sock"
+#else
+#define SOLVER_SOCKET_PATH "/tmp/speedcube_solver.sock"
+#endif
+
+#define SOLVER_PROTOCOL_VERSION (3)
+
+enum solver_request_type {
+  // Reply with the protocol version in depth
+  SOLVER_PING,
+  // Shortest solution of the whole cube
+  SOLVER_SOLVE,
+  // Every shortest solution of the whole cube
+  SOLVER_SOLVE_ALL,
+  // Lower bound for the number of moves needed to solve the whole cube
+  SOLVER_LOWER_BOUND,
+  // Number of moves needed to solve the cross and the front right F2L pair
+  SOLVER_XCROSS_DEPTH,
+  // Easiest shortest solution of the cross and the front right F2L pair
+  SOLVER_XCROSS_SOLVE,
+  // Short but not necessarily shortest solution of the whole cube from two_phase.c
+  SOLVER_SOLVE_TWO_PHASE,
+  // Best solution found within the budget with the proven lower bound in depth. No sequence if none was found.
+  SOLVER_SOLVE_BUDGETED,
+  NUM_SOLVER_REQUEST_TYPES,
+};
+
+enum solver_status {
+  SOLVER_OK,
+  SOLVER_BAD_REQUEST,
+  // The daemon was started without the table needed for the request
+  SOLVER_UNAVAILABLE,
+};
+
+typedef struct {
+  uint32_t type;
+  LocDirCube ldc;
+  // Two-phase requests stop at a solution this short or after this many milliseconds. Zero for the defaults.
+  uint32_t target_length;
+  uint32_t budget_ms;
+  // Budgeted requests also stop after this many nodes. Zero for no limit.
+  uint64_t max_nodes;
+} SolverRequest;
+
+typedef struct {
+  uint32_t status;
+  uint32_t depth;
+  uint64_t num_sequences;
+} SolverResponse;
+
+bool solver_read_fully(int fd, void *buffer, size_t num_bytes) {
+  char *it = buffer;
+  while (num_bytes) {
+    ssize_t num_read = read(fd, it, num_bytes);
+    if (num_read <= 0) {
+      return false;
+    }
+    it += num_read;
+    num_bytes -= num_read;
+  }
+  return true;
+}
+
+bool solver_write_fully(int fd, const void *buffer, size_t num_bytes) {
+  const char *it = buffer;
+  while (num_bytes) {
+    ssize_t num_written = write(fd, it, num_bytes);
+    if (num_written <= 0) {
+      return false;
+    }
+    it += num_written;
+    num_bytes -= num_written;
+  }
+  return true;
+}
+
+struct sockaddr_un solver_address() {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, SOLVER_SOCKET_PATH, sizeof(address.sun_path) - 1);
+  return address;
+}
+
+// Returns a connected socket or -1 if the daemon is not running
+int solver_connect() {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  struct sockaddr_un address = solver_address();
+  if (connect(fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*
+Send a request and wait for the response.
+The returned collection holds the num_sequences sequences of the response and must be freed by the caller.
+Returns NULL if the connection was lost.
+*/
+collection solver_send_request(int fd, SolverRequest *request, SolverResponse *response) {
+  if (!solver_write_fully(fd, request, sizeof(SolverRequest))) {
+    return NULL;
+  }
+  if (!solver_read_fully(fd, response, sizeof(SolverResponse))) {
+    return NULL;
+  }
+  collection result = malloc((response->num_sequences + 1) * sizeof(sequence));
+  if (!solver_read_fully(fd, result, response->num_sequences * sizeof(sequence))) {
+    free(result);
+    return NULL;
+  }
+  result[response->num_sequences] = SENTINEL;
+  return result;
+}
+
+// Same as solver_send_request with the default options
+collection solver_request(int fd, enum solver_request_type type, LocDirCube *ldc, SolverResponse *response) {
+  SolverRequest request;
+  memset(&request, 0, sizeof(request));
+  request.type = type;
+  if (ldc != NULL) {
+    request.ldc = *ldc;
+  }
+  return solver_send_request(fd, &request, response);
+}
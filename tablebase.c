@@ -1,5 +1,27 @@
 const unsigned char UNKNOWN = 255;
 
+// Cooperative cancellation of the searches in this and the following modules.
+// Any thread may cancel the token and the searches checking it give up at their next check.
+typedef struct {
+  bool cancelled;
+} CancelToken;
+
+// Token checked by the searches running on this thread. NULL if they cannot be cancelled.
+// Searches that fork worker threads hand it over to them.
+__thread CancelToken *SEARCH_CANCEL_TOKEN = NULL;
+
+CancelToken init_cancel_token() {
+  return (CancelToken) {false};
+}
+
+void cancel_searches(CancelToken *token) {
+  __atomic_store_n(&token->cancelled, true, __ATOMIC_RELAXED);
+}
+
+static inline bool search_cancelled() {
+  return SEARCH_CANCEL_TOKEN != NULL && __atomic_load_n(&SEARCH_CANCEL_TOKEN->cancelled, __ATOMIC_RELAXED);
+}
+
 typedef struct {
   unsigned char *octets;
   unsigned char *visits;
@@ -54,7 +76,8 @@ void free_nibblebase(Nibblebase *tablebase) {
   free(tablebase->visits);
 }
 
-bool update_nibblebase(Nibblebase *tablebase, LocDirCube *ldc, unsigned char depth, unsigned char max_depth) {
+// Moves are given as an array of stable moves so that tablebases can be restricted to a subgroup
+bool update_nibblebase_with(Nibblebase *tablebase, LocDirCube *ldc, unsigned char depth, unsigned char max_depth, enum move *moves, size_t num_moves) {
   if (depth >= max_depth) {
     return false;
   }
@@ -72,18 +95,22 @@ bool update_nibblebase(Nibblebase *tablebase, LocDirCube *ldc, unsigned char dep
     } else if (occupied) {
       return false;
     }
-    for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    for (size_t i = 0; i < num_moves; ++i) {
       LocDirCube child = *ldc;
-      locdir_apply_stable(&child, STABLE_MOVES[i]);
-      did_update = update_nibblebase(tablebase, &child, depth + 1, max_depth) || did_update;
+      locdir_apply_stable(&child, moves[i]);
+      did_update = update_nibblebase_with(tablebase, &child, depth + 1, max_depth, moves, num_moves) || did_update;
     }
   }
   return did_update;
 }
 
-void populate_nibblebase(Nibblebase *tablebase, LocDirCube *ldc) {
+bool update_nibblebase(Nibblebase *tablebase, LocDirCube *ldc, unsigned char depth, unsigned char max_depth) {
+  return update_nibblebase_with(tablebase, ldc, depth, max_depth, STABLE_MOVES, NUM_STABLE_MOVES);
+}
+
+void populate_nibblebase_with(Nibblebase *tablebase, LocDirCube *ldc, enum move *moves, size_t num_moves) {
   for (unsigned char max_depth = 1; max_depth < 16; ++max_depth) {
-    bool did_update = update_nibblebase(tablebase, ldc, 0, max_depth);
+    bool did_update = update_nibblebase_with(tablebase, ldc, 0, max_depth, moves, num_moves);
     if (!did_update) {
       break;
     }
@@ -93,11 +120,16 @@ void populate_nibblebase(Nibblebase *tablebase, LocDirCube *ldc) {
   }
 }
 
+void populate_nibblebase(Nibblebase *tablebase, LocDirCube *ldc) {
+  populate_nibblebase_with(tablebase, ldc, STABLE_MOVES, NUM_STABLE_MOVES);
+}
+
 unsigned char nibble_depth(Nibblebase *tablebase, LocDirCube *ldc) {
   return get_nibble(tablebase, (*tablebase->index_func)(ldc));
 }
 
 sequence nibble_solve(Nibblebase *tablebase, LocDirCube *ldc, bool (*better)(sequence a, sequence b)) {
+  prepare_locdir_orientations();
   LocDirCube aligned = *ldc;
   locdir_realign(&aligned);
   unsigned char depth = nibble_depth(tablebase, &aligned);
@@ -105,17 +137,22 @@ sequence nibble_solve(Nibblebase *tablebase, LocDirCube *ldc, bool (*better)(seq
     return I;
   }
 
-  sequence solve(LocDirCube *parent) {
+  // The cube is tracked in realigned form together with the orientation of its centers
+  sequence solve(LocDirCube *parent, unsigned char orientation) {
+    if (search_cancelled()) {
+      return INVALID;
+    }
     unsigned char best_depth = UNKNOWN;
     LocDirCube children[NUM_MOVES - 1];
+    unsigned char orientations[NUM_MOVES - 1];
     bool best[NUM_MOVES - 1];
     size_t i = 0;
     for (enum move move = U; move <= MAX_MOVE; ++move) {
+      OrientedMove oriented = LOCDIR_ORIENTED_MOVES[orientation][move];
       children[i] = *parent;
-      locdir_apply(children + i, move);
-      aligned = children[i];
-      locdir_realign(&aligned);
-      size_t index = (*tablebase->index_func)(&aligned);
+      locdir_apply_stable(children + i, oriented.move);
+      orientations[i] = oriented.orientation;
+      size_t index = (*tablebase->index_func)(children + i);
       unsigned char depth = get_nibble(tablebase, index);
       if (depth < best_depth) {
         best_depth = depth;
@@ -146,7 +183,7 @@ sequence nibble_solve(Nibblebase *tablebase, LocDirCube *ldc, bool (*better)(seq
     i = 0;
     for (enum move move = U; move <= MAX_MOVE; ++move) {
       if (best[i]) {
-        sequence candidate = concat(move, solve(children + i));
+        sequence candidate = concat(move, solve(children + i, orientations[i]));
         if ((*better)(candidate, solution)) {
           solution = candidate;
         }
@@ -156,10 +193,13 @@ sequence nibble_solve(Nibblebase *tablebase, LocDirCube *ldc, bool (*better)(seq
     return solution;
   }
 
-  return solve(ldc);
+  sequence solution = solve(&aligned, locdir_orientation(ldc));
+  return search_cancelled() ? INVALID : solution;
 }
 
+// Returns NULL if the search was cancelled
 collection nibble_solve_all(Nibblebase *tablebase, LocDirCube *ldc) {
+  prepare_locdir_orientations();
   LocDirCube aligned = *ldc;
   locdir_realign(&aligned);
   unsigned char depth = nibble_depth(tablebase, &aligned);
@@ -168,17 +208,21 @@ collection nibble_solve_all(Nibblebase *tablebase, LocDirCube *ldc) {
     return collection_push(result, I);
   }
 
-  collection solve(LocDirCube *parent) {
+  collection solve(LocDirCube *parent, unsigned char orientation) {
+    if (search_cancelled()) {
+      return NULL;
+    }
     unsigned char best_depth = UNKNOWN;
     LocDirCube children[NUM_MOVES - 1];
+    unsigned char orientations[NUM_MOVES - 1];
     bool best[NUM_MOVES - 1];
     size_t i = 0;
     for (enum move move = U; move <= MAX_MOVE; ++move) {
+      OrientedMove oriented = LOCDIR_ORIENTED_MOVES[orientation][move];
       children[i] = *parent;
-      locdir_apply(children + i, move);
-      aligned = children[i];
-      locdir_realign(&aligned);
-      size_t index = (*tablebase->index_func)(&aligned);
+      locdir_apply_stable(children + i, oriented.move);
+      orientations[i] = oriented.orientation;
+      size_t index = (*tablebase->index_func)(children + i);
       unsigned char depth = get_nibble(tablebase, index);
       if (depth < best_depth) {
         best_depth = depth;
@@ -209,7 +253,12 @@ collection nibble_solve_all(Nibblebase *tablebase, LocDirCube *ldc) {
     i = 0;
     for (enum move move = U; move <= MAX_MOVE; ++move) {
       if (best[i]) {
-        collection child_collection = solve(children + i);
+        collection child_collection = solve(children + i, orientations[i]);
+        if (search_cancelled()) {
+          free(child_collection);
+          free(result);
+          return NULL;
+        }
         collection it = child_collection;
         while (*it != SENTINEL) {
           result = collection_push(result, concat(move, *it));
@@ -222,5 +271,5 @@ collection nibble_solve_all(Nibblebase *tablebase, LocDirCube *ldc) {
     return result;
   }
 
-  return solve(ldc);
+  return solve(&aligned, locdir_orientation(ldc));
 }
@@ -3,12 +3,14 @@
 #include "time.h"
 #include "stdbool.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
 #include "locdir.c"
 #include "tablebase.c"
 #include "goalsphere.c"
+#include "two_phase.c"
 
 void create_corner_tablebase() {
   Cube cube;
@@ -191,7 +193,7 @@ void create_3x3x3_sphere() {
   locdir_reset(&ldc);
   cube = to_cube(&ldc);
   render(&cube);
-  sphere = init_goalsphere(&ldc, 6, &locdir_centerless_hash);
+  sphere = init_tagged_goalsphere(&ldc, 6, &locdir_centerless_hash, &locdir_centerless_tag);
   printf("Storing result...\n");
   #ifdef SCISSORS_ENABLED
   fptr = fopen("./tables/centerless_sphere_scissors.bin", "wb");
@@ -223,6 +225,50 @@ void create_3x3x3_sphere() {
   // Depth 5 has 2912447 unique configurations.
   // Depth 6 has 50839041 unique configurations.
   fclose(fptr);
+
+  printf("Storing tags...\n");
+  #ifdef SCISSORS_ENABLED
+  fptr = fopen("./tables/centerless_sphere_tags_scissors.bin", "wb");
+  #else
+  fptr = fopen("./tables/centerless_sphere_tags.bin", "wb");
+  #endif
+  if (fptr == NULL) {
+    fprintf(stderr, "Failed to open storage.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < sphere.num_sets; ++i) {
+    fwrite(sphere.tags[i], sizeof(unsigned char), sphere.set_sizes[i], fptr);
+  }
+  fclose(fptr);
+  free_goalsphere(&sphere);
+}
+
+void create_symmetric_sphere() {
+  FILE *fptr;
+  GoalSphere sphere;
+
+  #ifdef SCISSORS_ENABLED
+  size_t radius = 6;
+  #else
+  size_t radius = 7;
+  #endif
+  printf("Creating a goal sphere around the 3x3x3 solution up to rotation and inversion (implicit centers)...\n");
+  sphere = init_symmetric_goalsphere(radius, true);
+  printf("Storing result...\n");
+  #ifdef SCISSORS_ENABLED
+  fptr = fopen("./tables/centerless_symmetric_sphere_scissors.bin", "wb");
+  #else
+  fptr = fopen("./tables/centerless_symmetric_sphere.bin", "wb");
+  #endif
+  if (fptr == NULL) {
+    fprintf(stderr, "Failed to open storage.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < sphere.num_sets; ++i) {
+    printf("Depth %zu has %zu unique configurations.\n", i, sphere.set_sizes[i]);
+  }
+  fwrite_goalsphere(&sphere, fptr);
+  fclose(fptr);
   free_goalsphere(&sphere);
 }
 
@@ -263,6 +309,17 @@ void create_oll_sphere() {
   free_goalsphere(&sphere);
 }
 
+void create_two_phase_tables() {
+  printf("Creating tablebases for the two-phase solver...\n");
+  prepare_two_phase_solver();
+  printf("Storing result...\n");
+  if (!save_two_phase_tables()) {
+    fprintf(stderr, "Failed to open storage.\n");
+    exit(EXIT_FAILURE);
+  }
+  free_two_phase_solver();
+}
+
 int main() {
   #ifdef SCISSORS_ENABLED
   printf("Scissor moves enabled.\n");
@@ -279,6 +336,10 @@ int main() {
 
   create_3x3x3_sphere();
 
+  create_two_phase_tables();
+
+  // create_symmetric_sphere();
+
   // create_oll_sphere();
 
   return EXIT_SUCCESS;
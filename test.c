@@ -4,6 +4,7 @@
 #include "time.h"
 #include "stdbool.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
@@ -11,6 +12,9 @@
 #include "tablebase.c"
 #include "goalsphere.c"
 #include "ida_star.c"
+#include "solution_cache.c"
+#include "global_solver.c"
+#include "two_phase.c"
 
 typedef struct
 {
@@ -67,7 +71,7 @@ void test_hash_collisions() {
   free(pairs);
 
   printf("Correlating with GoalSphere...\n");
-  GoalSphere sphere = init_goalsphere(&root, depth, locdir_centerless_hash);
+  GoalSphere sphere = init_tagged_goalsphere(&root, depth, locdir_centerless_hash, locdir_centerless_tag);
   size_t sphere_total = 0;
   for (size_t i = 0; i < sphere.num_sets; ++i) {
     sphere_total += sphere.set_sizes[i];
@@ -75,9 +79,301 @@ void test_hash_collisions() {
   printf("%zu positions in the data structure.\n", sphere_total);
 
   assert(num_unique == sphere_total);
+
+  printf("Checking the layer filters...\n");
+  for (size_t i = 0; i < sphere.num_sets; ++i) {
+    if (sphere.filters[i].num_blocks == 0) {
+      continue;
+    }
+    for (size_t j = 0; j < sphere.set_sizes[i]; ++j) {
+      assert(bloom_may_contain(sphere.filters + i, sphere.sets[i][j]));
+    }
+    size_t num_false_positives = 0;
+    size_t num_probes = 100000;
+    for (size_t j = 0; j < num_probes; ++j) {
+      size_t hash = ((size_t) rand() << 32) ^ rand();
+      if (bloom_may_contain(sphere.filters + i, hash) && set_find(sphere.sets[i], sphere.set_sizes[i], hash) == OUTSIDE) {
+        num_false_positives++;
+      }
+    }
+    printf("Depth %zu filter: %g%% false positives.\n", i, 100.0 * num_false_positives / num_probes);
+    assert(num_false_positives < num_probes / 20);
+  }
+
+  printf("Checking that the tags resolve overflowing hashes...\n");
+  const unsigned __int128 CENTERLESS_SPACE = (unsigned __int128) LOCDIR_CORNER_INDEX_SPACE * (12ULL*11*10*9*8*7*6*5*4*3 * 2048);
+  const unsigned __int128 OVERFLOW = (unsigned __int128) 1 << 64;
+  for (size_t i = 0; i < 1000; ++i) {
+    LocDirCube ldc = root;
+    size_t num_moves = (i % 2) ? 20 : rand() % depth;
+    for (size_t j = 0; j < num_moves; ++j) {
+      locdir_apply_stable(&ldc, STABLE_MOVES[rand() % NUM_STABLE_MOVES]);
+    }
+    size_t hash = locdir_centerless_hash(&ldc);
+    unsigned char tag = locdir_centerless_tag(&ldc);
+    unsigned __int128 rank = ((unsigned __int128) tag << 64) | hash;
+    assert(rank < CENTERLESS_SPACE);
+    LocDirCube decoded;
+    locdir_centerless_unrank(&decoded, (size_t) rank, rank >> 64);
+    assert(locdir_equals(&decoded, &ldc));
+
+    // A different position with the same hash
+    LocDirCube twin;
+    unsigned __int128 twin_rank = (rank + OVERFLOW < CENTERLESS_SPACE) ? rank + OVERFLOW : rank - OVERFLOW;
+    locdir_centerless_unrank(&twin, (size_t) twin_rank, twin_rank >> 64);
+    assert(!locdir_equals(&twin, &ldc));
+    assert(locdir_centerless_hash(&twin) == hash);
+    assert(locdir_centerless_tag(&twin) != tag);
+    assert(goalsphere_depth_(&sphere, hash, locdir_centerless_tag(&twin)) == UNKNOWN);
+    if (num_moves < depth) {
+      assert(goalsphere_layer_with(&sphere, &ldc, locdir_centerless_hash) <= num_moves);
+      assert(goalsphere_layer_with(&sphere, &twin, locdir_centerless_hash) == UNKNOWN);
+      assert(!goalsphere_inside(&sphere, &twin));
+    }
+  }
+  printf("Every overflowing hash is told apart by its tag.\n");
+
+  size_t num_scrambles = 1000;
+  LocDirCube *scrambles = malloc(num_scrambles * sizeof(LocDirCube));
+  unsigned char *layers = malloc(num_scrambles * sizeof(unsigned char));
+  for (size_t i = 0; i < num_scrambles; ++i) {
+    LocDirCube ldc = root;
+    size_t num_moves = rand() % (depth + 3);
+    for (size_t j = 0; j < num_moves; ++j) {
+      locdir_apply_stable(&ldc, STABLE_MOVES[rand() % NUM_STABLE_MOVES]);
+    }
+    unsigned char layer = goalsphere_layer_with(&sphere, &ldc, locdir_centerless_hash);
+    assert(layer == goalsphere_depth(&sphere, &ldc, 0));
+    assert(goalsphere_inside(&sphere, &ldc) == (layer != UNKNOWN));
+    if (num_moves <= depth) {
+      assert(layer <= num_moves);
+    }
+    scrambles[i] = ldc;
+    layers[i] = layer;
+  }
+
+  printf("Checking batched queries...\n");
+  unsigned char *depths = malloc(num_scrambles * sizeof(unsigned char));
+  goalsphere_depths(&sphere, scrambles, num_scrambles, 0, depths);
+  for (size_t i = 0; i < num_scrambles; ++i) {
+    assert(depths[i] == layers[i]);
+  }
+  goalsphere_depths(&sphere, scrambles, num_scrambles, 2, depths);
+  for (size_t i = 0; i < num_scrambles; ++i) {
+    if (layers[i] != UNKNOWN) {
+      assert(depths[i] == layers[i]);
+    } else if (depths[i] != UNKNOWN) {
+      assert(depths[i] > depth && depths[i] <= depth + 2);
+    }
+  }
+
+  // Small batches give the same depths while holding no more than a batch per level
+  unsigned char *batched = malloc(num_scrambles * sizeof(unsigned char));
+  size_t peak = goalsphere_depths_batched(&sphere, scrambles, num_scrambles, 3, depths, GOALSPHERE_DEPTHS_BATCH);
+  assert(peak <= 3 * GOALSPHERE_DEPTHS_BATCH);
+  size_t batch_size = 4 * NUM_STABLE_MOVES;
+  peak = goalsphere_depths_batched(&sphere, scrambles, num_scrambles, 3, batched, batch_size);
+  assert(peak <= 3 * batch_size);
+  for (size_t i = 0; i < num_scrambles; ++i) {
+    assert(batched[i] == depths[i]);
+    if (layers[i] != UNKNOWN) {
+      assert(depths[i] == layers[i]);
+    } else if (depths[i] != UNKNOWN) {
+      assert(depths[i] > depth && depths[i] <= depth + 2);
+    }
+  }
+
+  // Far away positions reach more children than fit in a batch
+  LocDirCube far = root;
+  for (size_t j = 0; j < 20; ++j) {
+    locdir_apply_stable(&far, STABLE_MOVES[rand() % NUM_STABLE_MOVES]);
+  }
+  unsigned char far_depth;
+  peak = goalsphere_depths_batched(&sphere, &far, 1, 4, &far_depth, GOALSPHERE_DEPTHS_BATCH);
+  assert(peak <= 4 * GOALSPHERE_DEPTHS_BATCH);
+  assert(far_depth == UNKNOWN || far_depth <= depth + 4);
+  unsigned char batched_far_depth;
+  peak = goalsphere_depths_batched(&sphere, &far, 1, 4, &batched_far_depth, batch_size);
+  assert(peak <= 4 * batch_size);
+  assert(batched_far_depth == far_depth);
+
+  free(scrambles);
+  free(layers);
+  free(depths);
+  free(batched);
   free_goalsphere(&sphere);
 }
 
+void test_symmetric_goalsphere() {
+  printf("Comparing symmetry reduced goal spheres with the full one...\n");
+  size_t depth = 4;
+  LocDirCube root;
+  locdir_reset(&root);
+  GoalSphere full = init_tagged_goalsphere(&root, depth, locdir_centerless_hash, locdir_centerless_tag);
+  GoalSphere symmetric = init_symmetric_goalsphere(depth, false);
+  GoalSphere symmetric_inverse = init_symmetric_goalsphere(depth, true);
+  for (size_t i = 0; i <= depth; ++i) {
+    printf(
+      "Depth %zu: %zu positions, %zu up to rotation, %zu up to rotation and inversion.\n",
+      i,
+      full.set_sizes[i],
+      symmetric.set_sizes[i],
+      symmetric_inverse.set_sizes[i]
+    );
+    assert(symmetric.set_sizes[i] <= full.set_sizes[i]);
+    assert(symmetric_inverse.set_sizes[i] <= symmetric.set_sizes[i]);
+    assert(symmetric_inverse.set_sizes[i] * 2 * NUM_ORIENTATIONS >= full.set_sizes[i]);
+  }
+
+  for (size_t i = 0; i < 1000; ++i) {
+    LocDirCube ldc = root;
+    size_t num_moves = rand() % (depth + 2);
+    for (size_t j = 0; j < num_moves; ++j) {
+      locdir_apply_stable(&ldc, STABLE_MOVES[rand() % NUM_STABLE_MOVES]);
+    }
+    unsigned char layer = goalsphere_layer_with(&full, &ldc, locdir_centerless_hash);
+    assert(goalsphere_layer_with(&symmetric, &ldc, locdir_symmetric_hash) == layer);
+    assert(goalsphere_layer_with(&symmetric_inverse, &ldc, locdir_symmetric_inverse_hash) == layer);
+    LocDirCube inverse;
+    locdir_invert(&inverse, &ldc);
+    assert(locdir_symmetric_inverse_hash(&inverse) == locdir_symmetric_inverse_hash(&ldc));
+    assert(goalsphere_depth(&symmetric_inverse, &inverse, 0) == layer);
+  }
+
+  free_goalsphere(&full);
+  free_goalsphere(&symmetric);
+  free_goalsphere(&symmetric_inverse);
+  printf("Symmetry reduced goal spheres agree with the full one.\n");
+}
+
+bool goalspheres_equal(GoalSphere *a, GoalSphere *b) {
+  if (a->num_sets != b->num_sets) {
+    return false;
+  }
+  for (size_t i = 0; i < a->num_sets; ++i) {
+    if (a->set_sizes[i] != b->set_sizes[i]) {
+      return false;
+    }
+    for (size_t j = 0; j < a->set_sizes[i]; ++j) {
+      if (a->sets[i][j] != b->sets[i][j]) {
+        return false;
+      }
+      if (a->tags && a->tags[i][j] != b->tags[i][j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void test_goalsphere_extension() {
+  printf("Extending goal spheres...\n");
+  size_t depth = 4;
+  LocDirCube root;
+  locdir_reset(&root);
+
+  GoalSphere full = init_tagged_goalsphere(&root, depth, locdir_centerless_hash, locdir_centerless_tag);
+  GoalSphere searched = init_tagged_goalsphere(&root, 2, locdir_centerless_hash, locdir_centerless_tag);
+  extend_goalsphere(&searched, &root, depth);
+  assert(goalspheres_equal(&full, &searched));
+  GoalSphere unranked = init_tagged_goalsphere(&root, 2, locdir_centerless_hash, locdir_centerless_tag);
+  extend_centerless_goalsphere(&unranked, depth);
+  assert(goalspheres_equal(&full, &unranked));
+
+  GoalSphere symmetric = init_symmetric_goalsphere(depth, true);
+  GoalSphere extended = init_symmetric_goalsphere(1, true);
+  extend_centerless_goalsphere(&extended, depth);
+  assert(goalspheres_equal(&symmetric, &extended));
+
+  // Storage round trip
+  FILE *fptr = tmpfile();
+  fwrite_goalsphere(&extended, fptr);
+  rewind(fptr);
+  GoalSphere loaded = fread_goalsphere(fptr, locdir_symmetric_inverse_hash, locdir_symmetric_inverse_tag);
+  fclose(fptr);
+  assert(goalspheres_equal(&symmetric, &loaded));
+  // Spheres of other keys are told apart by the header
+  GoalSphereHeader header = goalsphere_header(locdir_symmetric_inverse_hash, locdir_symmetric_inverse_tag);
+  GoalSphereHeader other = goalsphere_header(locdir_symmetric_hash, locdir_symmetric_tag);
+  assert(header.probe_hash != other.probe_hash || header.probe_tag != other.probe_tag);
+  other = goalsphere_header(locdir_centerless_hash, locdir_centerless_tag);
+  assert(header.probe_hash != other.probe_hash || header.probe_tag != other.probe_tag);
+
+  free_goalsphere(&full);
+  free_goalsphere(&searched);
+  free_goalsphere(&unranked);
+  free_goalsphere(&symmetric);
+  free_goalsphere(&extended);
+  free_goalsphere(&loaded);
+  printf("Extended goal spheres match the ones built in one go.\n");
+}
+
+bool solves(LocDirCube *ldc, sequence solution) {
+  LocDirCube clone = *ldc;
+  locdir_apply_sequence(&clone, solution);
+  locdir_realign(&clone);
+  return locdir_solved(&clone);
+}
+
+void test_solution_cache() {
+  SolutionCache cache = init_solution_cache(1000);
+  for (int i = 0; i < 20; ++i) {
+    // Scramble with every kind of move so that the solutions leave the cube rotated
+    LocDirCube ldc;
+    locdir_reset(&ldc);
+    sequence scramble = I;
+    for (int j = 0; j < 15; ++j) {
+      enum move move = 1 + rand() % MAX_MOVE;
+      locdir_apply(&ldc, move);
+      scramble = NUM_MOVES * scramble + move;
+    }
+    size_t orientation = locdir_orientation(&ldc);
+    locdir_realign(&ldc);
+    sequence solution = locdir_conjugate_sequence(invert(scramble), orientation);
+    assert(solves(&ldc, solution));
+    solution_cache_put(&cache, &ldc, solution);
+
+    LocDirCube inverse;
+    locdir_invert(&inverse, &ldc);
+    for (size_t k = 0; k < NUM_ORIENTATIONS; ++k) {
+      LocDirCube symmetric[2];
+      locdir_conjugate(symmetric, &ldc, k);
+      locdir_conjugate(symmetric + 1, &inverse, k);
+      for (size_t l = 0; l < 2; ++l) {
+        sequence cached;
+        assert(solution_cache_get(&cache, symmetric + l, &cached));
+        assert(solves(symmetric + l, cached));
+        assert(sequence_length(cached) == sequence_length(solution));
+      }
+    }
+  }
+  assert(cache.hits == cache.lookups);
+
+  // Storage round trip
+  FILE *fptr = tmpfile();
+  fwrite_solution_cache(&cache, fptr);
+  rewind(fptr);
+  SolutionCache loaded = init_solution_cache(2);
+  fread_solution_cache(&loaded, fptr);
+  fclose(fptr);
+  assert(loaded.num_entries == 2);
+  assert(loaded.entries[loaded.newest].key == cache.entries[cache.newest].key);
+
+  // The least recently used entry goes first
+  size_t oldest = loaded.oldest;
+  size_t newest = loaded.newest;
+  solution_cache_insert(&loaded, loaded.entries[oldest].key, I);
+  solution_cache_insert(&loaded, 0, I);
+  assert(loaded.evictions == 1);
+  assert(solution_cache_find(&loaded, loaded.entries[oldest].key) != SOLUTION_CACHE_NONE);
+  assert(solution_cache_find(&loaded, 0) != SOLUTION_CACHE_NONE);
+  assert(loaded.entries[newest].key == 0);
+
+  free_solution_cache(&cache);
+  free_solution_cache(&loaded);
+  printf("Cached solutions map back through every symmetry.\n");
+}
+
 unsigned char testimator(LocDirCube *ldc) {
   for (int i = 0; i < 8; ++i) {
     if (ldc->corner_locs[i] != i) {
@@ -88,9 +384,7 @@ unsigned char testimator(LocDirCube *ldc) {
 }
 
 void test_ida_star() {
-  IDAstar ida;
-  ida.is_solved = locdir_centerless_solved;
-  ida.estimator = testimator;
+  IDAstar ida = init_ida_star(locdir_centerless_solved, testimator);
 
   LocDirCube ldc;
   locdir_reset(&ldc);
@@ -100,12 +394,76 @@ void test_ida_star() {
 
   ida_star_solve(&ida, &ldc, 0);
 
-  assert(ida.path_length == 4);
+  assert(ida.num_moves == 3);
 
   sequence solution = ida_to_sequence(&ida);
 
   assert(sequence_length(solution) == 3);
 
+  LocDirCube solved = ldc;
+  locdir_apply_sequence(&solved, solution);
+  locdir_realign(&solved);
+  assert(locdir_centerless_solved(&solved));
+
+  ida.move_ordering = ORDER_BY_ESTIMATE | ORDER_BY_KILLERS | ORDER_BY_HISTORY;
+  ida_star_solve(&ida, &ldc, 0);
+  assert(ida.num_moves == 3);
+  solved = ldc;
+  locdir_apply_sequence(&solved, ida_to_sequence(&ida));
+  locdir_realign(&solved);
+  assert(locdir_centerless_solved(&solved));
+  ida.move_ordering = 0;
+
+  ida_star_clear_stats(&ida);
+  ida_star_solve(&ida, &ldc, 0);
+  SearchStats stats = ida_star_stats(&ida);
+  assert(stats.num_nodes == ida.num_nodes);
+  assert(stats.num_nodes > 0);
+  #if IDA_STAR_INSTRUMENTATION
+  assert(stats.bound_stats[3].num_iterations == 1);
+  assert(stats.bound_stats[3].goal_hits == 1);
+  assert(stats.bound_stats[3].expanded <= stats.bound_stats[3].visited);
+  #endif
+
+  TranspositionTable table = init_transposition_table(1 << 16, locdir_centerless_hash);
+  ida.table = &table;
+  ida_star_solve(&ida, &ldc, 0);
+  assert(ida.num_moves == 3);
+  assert(ida.table_stats.probes > 0);
+  assert(ida.table_stats.hits <= ida.table_stats.probes);
+  assert(ida_to_sequence(&ida) == solution);
+  ida.table = NULL;
+  free_transposition_table(&table);
+
+  ida.track_inverse = true;
+  ida_star_solve(&ida, &ldc, 0);
+  assert(ida.num_moves == 3);
+  assert(ida_to_sequence(&ida) == solution);
+  LocDirCube inverse;
+  locdir_invert(&inverse, &ida.state);
+  assert(locdir_equals(&inverse, &ida.inverse));
+  ida.track_inverse = false;
+
+  // Budgets stop the search without a solution but with a proven bound
+  SearchBudget budget = init_search_budget(0, 0);
+  budget.max_bound = 2;
+  ida_star_set_budget(&ida, &budget);
+  assert(!ida_star_solve(&ida, &ldc, 0));
+  assert(ida.bound == 3);
+  budget.max_bound = UNKNOWN;
+  assert(ida_star_solve(&ida, &ldc, 0));
+  assert(ida_to_sequence(&ida) == solution);
+
+  LocDirCube scrambled = ldc;
+  locdir_apply_sequence(&scrambled, parse("R D2 L' B U2 R'"));
+  budget = init_search_budget(0, 1);
+  ida_star_set_budget(&ida, &budget);
+  assert(!ida_star_solve(&ida, &scrambled, 0));
+  assert(budget.exhausted);
+  assert(ida.bound <= 9);
+  assert(!ida_star_solve_parallel(&ida, &scrambled, 0));
+  ida_star_set_budget(&ida, NULL);
+
   collection solutions = ida_star_solve_all_stable(&ida, &ldc, 0);
   size_t num_solutions = 0;
 
@@ -125,6 +483,120 @@ void test_ida_star() {
   free(solutions);
 }
 
+void test_cancellation() {
+  printf("Cancelling searches...\n");
+  LocDirCube root;
+  locdir_reset(&root);
+  LocDirCube ldc = root;
+  locdir_apply_stable_sequence(&ldc, parse("R U F"));
+  LocDirCube scrambled = ldc;
+  locdir_apply_sequence(&scrambled, parse("R D2 L' B U2 R'"));
+
+  GoalSphere sphere = init_tagged_goalsphere(&root, 3, locdir_centerless_hash, locdir_centerless_tag);
+  Nibblebase cross = init_nibblebase(LOCDIR_CROSS_INDEX_SPACE, &locdir_cross_index);
+  populate_nibblebase(&cross, &root);
+  IDAstar ida = init_ida_star(locdir_centerless_solved, testimator);
+  // Only the goal sphere is needed for positions inside it
+  GLOBAL_SOLVER.goal = init_goalsphere(&root, 3, GLOBAL_GOAL_HASH);
+
+  // Searches under a live token run to completion
+  CancelToken token = init_cancel_token();
+  SEARCH_CANCEL_TOKEN = &token;
+  collection solutions = goalsphere_solve_all_stable(&sphere, &ldc, 0);
+  assert(solutions != NULL);
+  free(solutions);
+  assert(nibble_solve(&cross, &scrambled, &is_better) != INVALID);
+  solutions = nibble_solve_all(&cross, &scrambled);
+  assert(solutions != NULL);
+  free(solutions);
+  assert(ida_star_solve(&ida, &ldc, 0));
+  solutions = global_solve_all_stable(&ldc);
+  assert(solutions != NULL && *solutions != SENTINEL);
+  free(solutions);
+  solutions = global_solve_all(&ldc);
+  assert(solutions != NULL && *solutions != SENTINEL);
+  free(solutions);
+
+  // Cancelled searches give up and release what they had found
+  cancel_searches(&token);
+  assert(goalsphere_solve_all_stable(&sphere, &ldc, 0) == NULL);
+  assert(goalsphere_solve(&sphere, &ldc, 0, &is_better) == INVALID);
+  assert(nibble_solve(&cross, &scrambled, &is_better) == INVALID);
+  assert(nibble_solve_all(&cross, &scrambled) == NULL);
+  assert(!ida_star_solve(&ida, &scrambled, 0));
+  assert(!ida_star_solve_parallel(&ida, &scrambled, 0));
+  assert(ida_star_solve_all_stable(&ida, &scrambled, 0) == NULL);
+  assert(global_solve_all_stable(&ldc) == NULL);
+  assert(global_solve_all(&ldc) == NULL);
+  // Positions outside the goal sphere are given up before the tables are probed
+  assert(global_solve_all_stable(&scrambled) == NULL);
+  assert(global_solve_all(&scrambled) == NULL);
+
+  // The parallel search hands the token to its workers and leaves this thread's one in place
+  assert(SEARCH_CANCEL_TOKEN == &token);
+  SEARCH_CANCEL_TOKEN = NULL;
+
+  free_goalsphere(&GLOBAL_SOLVER.goal);
+  free_goalsphere(&sphere);
+  free_nibblebase(&cross);
+  printf("Cancelled searches gave up.\n");
+}
+
+void test_two_phase() {
+  printf("Solving with the two-phase solver...\n");
+  prepare_two_phase_solver();
+  Prng prng = init_prng(rand());
+  for (size_t i = 0; i < 5; ++i) {
+    LocDirCube ldc;
+    locdir_reset(&ldc);
+    locdir_scramble(&ldc, &prng);
+
+    double start = two_phase_clock();
+    sequence solution = two_phase_solve(&ldc, TWO_PHASE_DEFAULT_TARGET_LENGTH, 60);
+    assert(solution != INVALID);
+    // Reaching the target ends the search long before the budget
+    assert(sequence_length(solution) <= TWO_PHASE_DEFAULT_TARGET_LENGTH);
+    assert(two_phase_clock() - start < 30);
+    LocDirCube solved = ldc;
+    locdir_apply_stable_sequence(&solved, solution);
+    assert(locdir_solved(&solved));
+    // The ordinary moves may end in a rotated cube
+    solved = ldc;
+    locdir_apply_sequence(&solved, first_stable_expansion(solution));
+    locdir_realign(&solved);
+    assert(locdir_centerless_solved(&solved));
+
+    // Any solution meets a target of SEQUENCE_MAX_LENGTH so this is the time to the first one
+    start = two_phase_clock();
+    assert(two_phase_solve(&ldc, SEQUENCE_MAX_LENGTH, 60) != INVALID);
+    double first = two_phase_clock() - start;
+
+    // An unreachable target runs until the budget is spent, or the first solution is found if that takes longer,
+    // and keeps the best solution so far
+    start = two_phase_clock();
+    sequence best = two_phase_solve(&ldc, 0, 0.5);
+    double elapsed = two_phase_clock() - start;
+    assert(elapsed >= 0.5 && elapsed < 0.5 + 2 * first + 1);
+    assert(best != INVALID);
+    solved = ldc;
+    locdir_apply_sequence(&solved, first_stable_expansion(best));
+    locdir_realign(&solved);
+    assert(locdir_centerless_solved(&solved));
+  }
+
+  LocDirCube ldc;
+  locdir_reset(&ldc);
+  locdir_scramble(&ldc, &prng);
+  CancelToken token = init_cancel_token();
+  cancel_searches(&token);
+  SEARCH_CANCEL_TOKEN = &token;
+  assert(two_phase_solve(&ldc, TWO_PHASE_DEFAULT_TARGET_LENGTH, 60) == INVALID);
+  SEARCH_CANCEL_TOKEN = NULL;
+
+  free_two_phase_solver();
+  printf("Two-phase solutions solve the cube.\n");
+}
+
 void test_sequence() {
   sequence seq = parse("F U' F'");
 
@@ -133,6 +605,206 @@ void test_sequence() {
   assert(collection_size(variants) == 8);
 
   free(variants);
+
+  LocDirCube a, b;
+  seq = parse("R M2 U' E S F");
+  locdir_reset(&a);
+  locdir_reset(&b);
+  locdir_apply_stable_sequence(&a, seq);
+  locdir_apply_sequence(&b, first_stable_expansion(seq));
+  locdir_realign(&b);
+  assert(locdir_equals(&a, &b));
+
+  locdir_reset(&a);
+  locdir_reset(&b);
+  locdir_apply_string(&a, "R U' [F2 B] M' S2 E D L2");
+  locdir_apply_sequence(&b, parse("R U' [F2 B] M' S2 E D L2"));
+  assert(locdir_equals(&a, &b));
+
+  locdir_realign(&a);
+  assert(locdir_is_solvable(&a));
+  a.corner_dirs[0] = (a.corner_dirs[0] + 1) % 3;
+  assert(!locdir_is_solvable(&a));
+  locdir_realign(&b);
+  b.edge_dirs[3] = !b.edge_dirs[3];
+  assert(!locdir_is_solvable(&b));
+  locdir_reset(&b);
+  b.edge_locs[0] = 1;
+  b.edge_locs[1] = 0;
+  assert(!locdir_is_solvable(&b));
+}
+
+void test_prng() {
+  // Reference outputs of xoshiro256**
+  Prng prng = {{1, 2, 3, 4}};
+  assert(prng_next(&prng) == 11520);
+  assert(prng_next(&prng) == 0);
+  assert(prng_next(&prng) == 1509978240);
+  assert(prng_next(&prng) == 1215971899390074240ULL);
+
+  Prng a = init_prng(42);
+  Prng b = init_prng(42);
+  Cube x, y;
+  reset(&x);
+  reset(&y);
+  sequence s = make_scramble(&x, 20, &a);
+  assert(s == make_scramble(&y, 20, &b));
+  assert(sequence_length(s) == 20);
+
+  // Copies replay the same scramble
+  LocDirCube c, d;
+  locdir_reset(&c);
+  locdir_reset(&d);
+  b = a;
+  locdir_scramble(&c, &a);
+  locdir_scramble(&d, &b);
+  assert(locdir_equals(&c, &d));
+
+  a = init_prng_stream(42, 1);
+  b = init_prng_stream(42, 1);
+  assert(prng_next(&a) == prng_next(&b));
+  b = init_prng_stream(42, 0);
+  assert(prng_next(&a) != prng_next(&b));
+  b = init_prng_stream(43, 1);
+  assert(prng_next(&a) != prng_next(&b));
+
+  size_t counts[6] = {0};
+  for (int i = 0; i < 60000; ++i) {
+    uint64_t r = prng_below(&a, 6);
+    assert(r < 6);
+    counts[r]++;
+  }
+  for (int i = 0; i < 6; ++i) {
+    assert(counts[i] > 9000 && counts[i] < 11000);
+  }
+  assert(prng_below(&a, 1) == 0);
+}
+
+void test_domino() {
+  LocDirCube ldc;
+  locdir_reset(&ldc);
+  assert(locdir_domino_solved(&ldc));
+  assert(locdir_domino_twist_slice_index(&ldc) == 69);
+  assert(locdir_domino_flip_slice_index(&ldc) == 69);
+  assert(locdir_domino_corner_slice_index(&ldc) == 0);
+  assert(locdir_domino_edge_slice_index(&ldc) == 0);
+
+  // The subgroup is closed under its moves and every index stays in range
+  enum move domino_moves[] = {U, U_prime, U2, D, D_prime, D2, R2, L2, F2, B2, E2, M2, S2};
+  for (size_t i = 0; i < 1000; ++i) {
+    locdir_apply_stable(&ldc, domino_moves[rand() % 13]);
+    assert(locdir_domino_solved(&ldc));
+    assert(locdir_domino_twist_slice_index(&ldc) == 69);
+    assert(locdir_domino_flip_slice_index(&ldc) == 69);
+    assert(locdir_domino_corner_slice_index(&ldc) < LOCDIR_DOMINO_CORNER_SLICE_INDEX_SPACE);
+    assert(locdir_domino_edge_slice_index(&ldc) < LOCDIR_DOMINO_EDGE_SLICE_INDEX_SPACE);
+  }
+
+  enum move other_moves[] = {U, R, F, D, L, B, E, M, S};
+  for (size_t i = 0; i < 1000; ++i) {
+    locdir_apply_stable(&ldc, other_moves[rand() % 9]);
+    assert(locdir_domino_twist_slice_index(&ldc) < LOCDIR_DOMINO_TWIST_SLICE_INDEX_SPACE);
+    assert(locdir_domino_flip_slice_index(&ldc) < LOCDIR_DOMINO_FLIP_SLICE_INDEX_SPACE);
+  }
+
+  locdir_reset(&ldc);
+  locdir_apply_stable(&ldc, R);
+  assert(!locdir_domino_solved(&ldc));
+  locdir_reset(&ldc);
+  locdir_apply_stable(&ldc, F);
+  assert(!locdir_domino_solved(&ldc));
+}
+
+void test_orientations() {
+  prepare_locdir_orientations();
+
+  LocDirCube solved;
+  locdir_reset(&solved);
+
+  // Stable moves need to be distinct for the tables to be unambiguous
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    LocDirCube a = solved;
+    locdir_apply_stable(&a, STABLE_MOVES[i]);
+    assert(!locdir_equals(&a, &solved));
+    for (size_t j = 0; j < i; ++j) {
+      LocDirCube b = solved;
+      locdir_apply_stable(&b, STABLE_MOVES[j]);
+      assert(!locdir_equals(&a, &b));
+    }
+  }
+
+  for (size_t j = 0; j < 100; ++j) {
+    LocDirCube ldc = solved;
+    for (size_t i = 0; i < 20; ++i) {
+      locdir_apply(&ldc, 1 + rand() % MAX_MOVE);
+    }
+    LocDirCube aligned = ldc;
+    locdir_realign(&aligned);
+    unsigned char orientation = locdir_orientation(&ldc);
+
+    for (enum move move = U; move <= MAX_MOVE; ++move) {
+      OrientedMove oriented = LOCDIR_ORIENTED_MOVES[orientation][move];
+
+      LocDirCube child = ldc;
+      locdir_apply(&child, move);
+      assert(oriented.orientation == locdir_orientation(&child));
+      locdir_realign(&child);
+
+      LocDirCube stable = aligned;
+      locdir_apply_stable(&stable, oriented.move);
+      assert(locdir_equals(&child, &stable));
+    }
+  }
+
+  printf("All orientation tests pass!\n");
+}
+
+void test_inverse() {
+  prepare_locdir_orientations();
+
+  LocDirCube solved;
+  locdir_reset(&solved);
+
+  for (int i = 0; i < 100; ++i) {
+    LocDirCube ldc = solved;
+    sequence scramble = I;
+    for (int j = 0; j < 20; ++j) {
+      size_t move_index = rand() % NUM_STABLE_MOVES;
+      LocDirCube product;
+      locdir_multiply(&product, &ldc, STABLE_MOVE_CUBES + move_index);
+      locdir_apply_stable(&ldc, STABLE_MOVES[move_index]);
+      assert(locdir_equals(&product, &ldc));
+      scramble = NUM_MOVES * scramble + STABLE_MOVES[move_index];
+    }
+
+    LocDirCube inverse;
+    locdir_invert(&inverse, &ldc);
+    LocDirCube unscrambled = solved;
+    locdir_apply_stable_sequence(&unscrambled, invert(scramble));
+    assert(locdir_equals(&inverse, &unscrambled));
+
+    LocDirCube product;
+    locdir_multiply(&product, &ldc, &inverse);
+    assert(locdir_equals(&product, &solved));
+  }
+
+  // Conjugating permutes the stable moves
+  for (size_t i = 0; i < NUM_ORIENTATIONS; ++i) {
+    for (size_t j = 0; j < NUM_STABLE_MOVES; ++j) {
+      LocDirCube conjugate;
+      locdir_conjugate(&conjugate, STABLE_MOVE_CUBES + j, i);
+      bool found = false;
+      for (size_t k = 0; k < NUM_STABLE_MOVES; ++k) {
+        found = found || locdir_equals(&conjugate, STABLE_MOVE_CUBES + k);
+      }
+      assert(found);
+    }
+    LocDirCube conjugate;
+    locdir_conjugate(&conjugate, &solved, i);
+    assert(locdir_equals(&conjugate, &solved));
+  }
+
+  printf("All inverse and conjugation tests pass!\n");
 }
 
 void test_locdir() {
@@ -507,11 +1179,22 @@ int main() {
 
   test_locdir();
 
+  test_orientations();
+
+  test_inverse();
+
   test_ida_star();
 
   test_sequence();
+  test_prng();
+  test_domino();
 
   test_hash_collisions();
+  test_symmetric_goalsphere();
+  test_goalsphere_extension();
+  test_solution_cache();
+  test_cancellation();
+  test_two_phase();
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,260 @@
+/*
+Two-phase solver for when an answer is needed fast and it does not have to be optimal.
+
+The first phase takes the cube into the domino subgroup <U, D, R2, L2, F2, B2> using any stable move.
+The second phase solves it using only the stable moves that stay inside the subgroup.
+Both phases are IDA* searches pruned by small tablebases over the domino coordinates of locdir.c.
+After the first solution the search continues with longer first phases looking for shorter totals
+until the target length is reached or the time budget runs out.
+*/
+
+// Number of nodes between checks of the clock
+#define TWO_PHASE_CHECK_INTERVAL (1 << 12)
+
+// Used by the programs when a request does not say how hard to try
+#define TWO_PHASE_DEFAULT_TARGET_LENGTH (20)
+#define TWO_PHASE_DEFAULT_TIME_BUDGET (0.1)
+
+#ifdef SCISSORS_ENABLED
+#define TWO_PHASE_TABLE_PATH(name) "./tables/two_phase_" name "_scissors.bin"
+#else
+#define TWO_PHASE_TABLE_PATH(name) "./tables/two_phase_" name ".bin"
+#endif
+
+typedef struct {
+  // First phase distances to the subgroup
+  Nibblebase twist_slice;
+  Nibblebase flip_slice;
+  // Second phase distances to solved inside the subgroup
+  Nibblebase corner_slice;
+  Nibblebase edge_slice;
+  // Indices into STABLE_MOVES of the moves that keep the cube inside the subgroup
+  unsigned char domino_moves[NUM_STABLE_MOVES];
+  size_t num_domino_moves;
+  bool is_domino_move[NUM_STABLE_MOVES];
+  // The second move is skipped if the pair equals a single move or is the same in the other order
+  bool redundant[NUM_STABLE_MOVES][NUM_STABLE_MOVES];
+} TwoPhaseSolver;
+
+TwoPhaseSolver TWO_PHASE_SOLVER;
+
+double two_phase_clock() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+void prepare_two_phase_moves() {
+  LocDirCube solved;
+  locdir_reset(&solved);
+  LocDirCube cubes[NUM_STABLE_MOVES];
+  TWO_PHASE_SOLVER.num_domino_moves = 0;
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    cubes[i] = solved;
+    locdir_apply_stable(cubes + i, STABLE_MOVES[i]);
+    TWO_PHASE_SOLVER.is_domino_move[i] = locdir_domino_solved(cubes + i);
+    if (TWO_PHASE_SOLVER.is_domino_move[i]) {
+      TWO_PHASE_SOLVER.domino_moves[TWO_PHASE_SOLVER.num_domino_moves++] = i;
+    }
+  }
+  for (size_t i = 0; i < NUM_STABLE_MOVES; ++i) {
+    for (size_t j = 0; j < NUM_STABLE_MOVES; ++j) {
+      LocDirCube pair = cubes[i];
+      locdir_apply_stable(&pair, STABLE_MOVES[j]);
+      LocDirCube swapped = cubes[j];
+      locdir_apply_stable(&swapped, STABLE_MOVES[i]);
+      bool redundant = locdir_equals(&pair, &solved) || (j < i && locdir_equals(&pair, &swapped));
+      for (size_t k = 0; k < NUM_STABLE_MOVES; ++k) {
+        redundant = redundant || locdir_equals(&pair, cubes + k);
+      }
+      TWO_PHASE_SOLVER.redundant[i][j] = redundant;
+    }
+  }
+}
+
+bool load_two_phase_table(Nibblebase *tablebase, size_t index_space, const char *path) {
+  FILE *fptr = fopen(path, "rb");
+  if (fptr == NULL) {
+    return false;
+  }
+  size_t tablebase_size = (index_space + 1) / 2;
+  fread_exactly(tablebase->octets, sizeof(unsigned char), tablebase_size, fptr);
+  fclose(fptr);
+  return true;
+}
+
+bool save_two_phase_table(Nibblebase *tablebase, size_t index_space, const char *path) {
+  FILE *fptr = fopen(path, "wb");
+  if (fptr == NULL) {
+    return false;
+  }
+  fwrite(tablebase->octets, sizeof(unsigned char), (index_space + 1) / 2, fptr);
+  fclose(fptr);
+  return true;
+}
+
+// Load the tables stored by tabulate.c or generate them if missing which takes a while
+void prepare_two_phase_solver() {
+  prepare_two_phase_moves();
+
+  LocDirCube solved;
+  locdir_reset(&solved);
+  enum move domino_moves[NUM_STABLE_MOVES];
+  for (size_t i = 0; i < TWO_PHASE_SOLVER.num_domino_moves; ++i) {
+    domino_moves[i] = STABLE_MOVES[TWO_PHASE_SOLVER.domino_moves[i]];
+  }
+
+  TWO_PHASE_SOLVER.twist_slice = init_nibblebase(LOCDIR_DOMINO_TWIST_SLICE_INDEX_SPACE, locdir_domino_twist_slice_index);
+  TWO_PHASE_SOLVER.flip_slice = init_nibblebase(LOCDIR_DOMINO_FLIP_SLICE_INDEX_SPACE, locdir_domino_flip_slice_index);
+  TWO_PHASE_SOLVER.corner_slice = init_nibblebase(LOCDIR_DOMINO_CORNER_SLICE_INDEX_SPACE, locdir_domino_corner_slice_index);
+  TWO_PHASE_SOLVER.edge_slice = init_nibblebase(LOCDIR_DOMINO_EDGE_SLICE_INDEX_SPACE, locdir_domino_edge_slice_index);
+
+  if (!load_two_phase_table(&TWO_PHASE_SOLVER.twist_slice, LOCDIR_DOMINO_TWIST_SLICE_INDEX_SPACE, TWO_PHASE_TABLE_PATH("twist_slice"))) {
+    fprintf(stderr, "Generating the two-phase twist tablebase.\n");
+    populate_nibblebase(&TWO_PHASE_SOLVER.twist_slice, &solved);
+  }
+  if (!load_two_phase_table(&TWO_PHASE_SOLVER.flip_slice, LOCDIR_DOMINO_FLIP_SLICE_INDEX_SPACE, TWO_PHASE_TABLE_PATH("flip_slice"))) {
+    fprintf(stderr, "Generating the two-phase flip tablebase.\n");
+    populate_nibblebase(&TWO_PHASE_SOLVER.flip_slice, &solved);
+  }
+  if (!load_two_phase_table(&TWO_PHASE_SOLVER.corner_slice, LOCDIR_DOMINO_CORNER_SLICE_INDEX_SPACE, TWO_PHASE_TABLE_PATH("corner_slice"))) {
+    fprintf(stderr, "Generating the two-phase corner tablebase.\n");
+    populate_nibblebase_with(&TWO_PHASE_SOLVER.corner_slice, &solved, domino_moves, TWO_PHASE_SOLVER.num_domino_moves);
+  }
+  if (!load_two_phase_table(&TWO_PHASE_SOLVER.edge_slice, LOCDIR_DOMINO_EDGE_SLICE_INDEX_SPACE, TWO_PHASE_TABLE_PATH("edge_slice"))) {
+    fprintf(stderr, "Generating the two-phase edge tablebase.\n");
+    populate_nibblebase_with(&TWO_PHASE_SOLVER.edge_slice, &solved, domino_moves, TWO_PHASE_SOLVER.num_domino_moves);
+  }
+}
+
+bool save_two_phase_tables() {
+  return (
+    save_two_phase_table(&TWO_PHASE_SOLVER.twist_slice, LOCDIR_DOMINO_TWIST_SLICE_INDEX_SPACE, TWO_PHASE_TABLE_PATH("twist_slice")) &&
+    save_two_phase_table(&TWO_PHASE_SOLVER.flip_slice, LOCDIR_DOMINO_FLIP_SLICE_INDEX_SPACE, TWO_PHASE_TABLE_PATH("flip_slice")) &&
+    save_two_phase_table(&TWO_PHASE_SOLVER.corner_slice, LOCDIR_DOMINO_CORNER_SLICE_INDEX_SPACE, TWO_PHASE_TABLE_PATH("corner_slice")) &&
+    save_two_phase_table(&TWO_PHASE_SOLVER.edge_slice, LOCDIR_DOMINO_EDGE_SLICE_INDEX_SPACE, TWO_PHASE_TABLE_PATH("edge_slice"))
+  );
+}
+
+void free_two_phase_solver() {
+  free_nibblebase(&TWO_PHASE_SOLVER.twist_slice);
+  free_nibblebase(&TWO_PHASE_SOLVER.flip_slice);
+  free_nibblebase(&TWO_PHASE_SOLVER.corner_slice);
+  free_nibblebase(&TWO_PHASE_SOLVER.edge_slice);
+}
+
+unsigned char two_phase_first_estimate(LocDirCube *ldc) {
+  unsigned char twist = nibble_depth(&TWO_PHASE_SOLVER.twist_slice, ldc);
+  unsigned char flip = nibble_depth(&TWO_PHASE_SOLVER.flip_slice, ldc);
+  return twist > flip ? twist : flip;
+}
+
+unsigned char two_phase_second_estimate(LocDirCube *ldc) {
+  unsigned char corners = nibble_depth(&TWO_PHASE_SOLVER.corner_slice, ldc);
+  unsigned char edges = nibble_depth(&TWO_PHASE_SOLVER.edge_slice, ldc);
+  return corners > edges ? corners : edges;
+}
+
+/*
+Solve a cube with its centers in the standard position.
+The solution is in stable moves. Pass it through first_stable_expansion to get ordinary moves.
+Returns the first solution found once its length is at most target_length or time_budget seconds have passed.
+The search only gives up on finding any solution if none fits in SEQUENCE_MAX_LENGTH or it is cancelled.
+*/
+sequence two_phase_solve(LocDirCube *ldc, size_t target_length, double time_budget) {
+  double deadline = two_phase_clock() + time_budget;
+  unsigned char moves[SEQUENCE_MAX_LENGTH];
+  unsigned char best_moves[SEQUENCE_MAX_LENGTH];
+  size_t best_length = SEQUENCE_MAX_LENGTH + 1;
+  size_t num_nodes = 0;
+  // A search that is already cancelled does not start
+  bool done = search_cancelled();
+
+  // Only stop early once there is something to return unless cancelled
+  void count_node() {
+    num_nodes++;
+    if (num_nodes % TWO_PHASE_CHECK_INTERVAL == 0 && (search_cancelled() || (best_length <= SEQUENCE_MAX_LENGTH && two_phase_clock() > deadline))) {
+      done = true;
+    }
+  }
+
+  size_t solution_length;
+
+  bool second_phase(LocDirCube *parent, size_t depth, size_t bound) {
+    count_node();
+    unsigned char estimate = two_phase_second_estimate(parent);
+    if (estimate == 0) {
+      solution_length = depth;
+      return true;
+    }
+    if (depth + estimate > bound || done) {
+      return false;
+    }
+    for (size_t i = 0; i < TWO_PHASE_SOLVER.num_domino_moves; ++i) {
+      unsigned char move = TWO_PHASE_SOLVER.domino_moves[i];
+      if (depth && TWO_PHASE_SOLVER.redundant[moves[depth - 1]][move]) {
+        continue;
+      }
+      LocDirCube child = *parent;
+      locdir_apply_stable(&child, STABLE_MOVES[move]);
+      moves[depth] = move;
+      if (second_phase(&child, depth + 1, bound)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void start_second_phase(LocDirCube *domino, size_t first_length) {
+    for (size_t bound = first_length + two_phase_second_estimate(domino); bound < best_length && !done; ++bound) {
+      if (second_phase(domino, first_length, bound)) {
+        best_length = solution_length;
+        for (size_t i = 0; i < best_length; ++i) {
+          best_moves[i] = moves[i];
+        }
+        done = done || best_length <= target_length;
+        return;
+      }
+    }
+  }
+
+  void first_phase(LocDirCube *parent, size_t depth, size_t bound) {
+    count_node();
+    unsigned char estimate = two_phase_first_estimate(parent);
+    if (estimate == 0 && depth == bound) {
+      // Ending in a domino move means that a shorter first phase already covered this
+      if (depth == 0 || !TWO_PHASE_SOLVER.is_domino_move[moves[depth - 1]]) {
+        start_second_phase(parent, depth);
+      }
+      return;
+    }
+    if (depth + estimate > bound || done) {
+      return;
+    }
+    for (size_t move = 0; move < NUM_STABLE_MOVES; ++move) {
+      if (depth && TWO_PHASE_SOLVER.redundant[moves[depth - 1]][move]) {
+        continue;
+      }
+      LocDirCube child = *parent;
+      locdir_apply_stable(&child, STABLE_MOVES[move]);
+      moves[depth] = move;
+      first_phase(&child, depth + 1, bound);
+      if (done) {
+        return;
+      }
+    }
+  }
+
+  for (size_t bound = two_phase_first_estimate(ldc); bound < best_length && !done; ++bound) {
+    first_phase(ldc, 0, bound);
+  }
+
+  if (best_length > SEQUENCE_MAX_LENGTH) {
+    return INVALID;
+  }
+  sequence result = I;
+  for (size_t i = 0; i < best_length; ++i) {
+    result = NUM_MOVES * result + STABLE_MOVES[best_moves[i]];
+  }
+  return result;
+}
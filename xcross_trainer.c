@@ -3,6 +3,7 @@
 #include "time.h"
 #include "stdbool.h"
 
+#include "prng.c"
 #include "cube.c"
 #include "moves.c"
 #include "sequence.c"
@@ -10,7 +11,7 @@
 #include "tablebase.c"
 
 int main() {
-  srand(time(NULL));
+  Prng prng = init_prng(time(NULL));
 
   FILE *fptr;
   size_t num_read;
@@ -45,7 +46,7 @@ int main() {
   for (;;) {
     locdir_reset_xcross(&ldc);
     cube = to_cube(&ldc);
-    sequence s = make_scramble(&cube, 9 + rand() % 5);
+    sequence s = make_scramble(&cube, 9 + prng_below(&prng, 5), &prng);
     locdir_apply_sequence(&ldc, s);
     unsigned char depth = nibble_depth(&tablebase, &ldc);
 